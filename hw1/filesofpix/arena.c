@@ -0,0 +1,169 @@
+/* 
+ *   arena.c
+ *   by: Drew Maynard and Joel Brandinger, 01/27/21
+ *   Files, Pictures and Interfaces
+ *
+ *   This file contains the implementation of the arena allocator. Chunks
+ *   are kept on a linked list; an allocation that does not fit in the
+ *   current chunk starts a new one. Requests bigger than a chunk get a
+ *   chunk of their own. Resetting an arena keeps its regular-sized chunks
+ *   on a free list, so the next file reuses the same memory.
+*/
+
+#include <stdlib.h>
+#include <assert.h>
+#include "arena.h"
+
+#define T Arena_T
+#define DEFAULT_CHUNKSIZE (1 << 20)
+#define ALIGNMENT 8
+
+struct Chunk {
+    struct Chunk *next;
+    size_t size;
+    size_t used;
+};
+
+struct T {
+    struct Chunk *chunks;
+    struct Chunk *spare;
+    size_t chunksize;
+    size_t held;
+};
+
+static struct Chunk *newChunk(size_t size);
+
+/* Arena_new
+ *
+ *    Purpose: Create an empty arena
+ * Parameters: The size of each chunk in bytes (0 picks a default)
+ *    Returns: A pointer to the new arena
+*/
+extern T Arena_new(size_t chunksize)
+{
+    T arena = (void*)malloc(sizeof(struct T));
+    assert(arena != NULL);
+    arena->chunks = NULL;
+    arena->spare = NULL;
+    arena->chunksize = chunksize > 0 ? chunksize : DEFAULT_CHUNKSIZE;
+    arena->held = 0;
+    return arena;
+}
+
+/* Arena_free
+ *
+ *    Purpose: Deallocate the arena and everything that was allocated in it
+ * Parameters: A reference to the arena
+ *    Returns: None
+*/
+extern void Arena_free(T *arena)
+{
+    assert(arena != NULL && *arena != NULL);
+    Arena_reset(*arena);
+    struct Chunk *chunk = (*arena)->spare;
+    while (chunk != NULL) {
+        struct Chunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(*arena);
+    *arena = NULL;
+}
+
+/* Arena_reset
+ *
+ *    Purpose: Give back everything allocated in the arena while keeping
+ *             the memory for later allocations. Oversized chunks are freed
+ *             since they are unlikely to fit the next file.
+ * Parameters: The arena
+ *    Returns: None
+*/
+extern void Arena_reset(T arena)
+{
+    assert(arena != NULL);
+    struct Chunk *chunk = arena->chunks;
+    while (chunk != NULL) {
+        struct Chunk *next = chunk->next;
+        if (chunk->size == arena->chunksize) {
+            chunk->used = 0;
+            chunk->next = arena->spare;
+            arena->spare = chunk;
+        } else {
+            free(chunk);
+        }
+        chunk = next;
+    }
+    arena->chunks = NULL;
+    arena->held = 0;
+}
+
+/* Arena_alloc
+ *
+ *    Purpose: Allocate memory that lives as long as the arena
+ * Parameters: The arena and the number of bytes needed
+ *    Returns: A pointer to the memory, aligned for any basic type
+*/
+extern void *Arena_alloc(T arena, size_t nbytes)
+{
+    assert(arena != NULL);
+    nbytes = (nbytes + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+
+    struct Chunk *chunk = arena->chunks;
+    if (nbytes > arena->chunksize && chunk != NULL) {
+        /* oversized: give it its own chunk behind the current one */
+        struct Chunk *big = newChunk(nbytes);
+        big->next = chunk->next;
+        chunk->next = big;
+        big->used = nbytes;
+        arena->held += nbytes;
+        return big + 1;
+    }
+
+    if (chunk == NULL || chunk->size - chunk->used < nbytes) {
+        size_t size = nbytes > arena->chunksize ? nbytes : arena->chunksize;
+        if (size == arena->chunksize && arena->spare != NULL) {
+            chunk = arena->spare;
+            arena->spare = chunk->next;
+        } else {
+            chunk = newChunk(size);
+        }
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+        arena->held += size;
+    }
+
+    void *memory = (char*)(chunk + 1) + chunk->used;
+    chunk->used += nbytes;
+    return memory;
+}
+
+/* Arena_size
+ *
+ *    Purpose: Report how much memory the arena is using
+ * Parameters: The arena
+ *    Returns: The total size of the chunks allocated from since the arena
+ *             was made or last reset, in bytes
+*/
+extern size_t Arena_size(T arena)
+{
+    assert(arena != NULL);
+    return arena->held;
+}
+
+/* newChunk
+ *
+ *    Purpose: Allocate a chunk with room for size bytes after its header
+ * Parameters: The usable size of the chunk
+ *    Returns: A pointer to the chunk
+*/
+static struct Chunk *newChunk(size_t size)
+{
+    struct Chunk *chunk = malloc(sizeof(struct Chunk) + size);
+    assert(chunk != NULL);
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    return chunk;
+}
+
+#undef T
@@ -0,0 +1,28 @@
+/* 
+ *   arena.h
+ *   by: Drew Maynard and Joel Brandinger, 01/27/21
+ *   Files, Pictures and Interfaces
+ *
+ *   This file contains the interface for a simple arena allocator. Memory
+ *   is carved out of large chunks and can only be given back all at once,
+ *   which is exactly the lifetime of everything restoration allocates for
+ *   one file.
+*/
+
+#ifndef ARENA_INCLUDED
+#define ARENA_INCLUDED
+
+#include <stddef.h>
+
+#define T Arena_T
+typedef struct T *T;
+
+extern T Arena_new(size_t chunksize);
+extern void Arena_free(T *arena);
+extern void Arena_reset(T arena);
+
+extern void *Arena_alloc(T arena, size_t nbytes);
+extern size_t Arena_size(T arena);
+
+#undef T
+#endif
@@ -0,0 +1,338 @@
+/* 
+ *   batch.c
+ *   by: Drew Maynard and Joel Brandinger, 01/27/21
+ *   Files, Pictures and Interfaces
+ *
+ *   This file contains the implementation of batch restoration. Each
+ *   worker owns one restoration state (arena and scratch buffers) and one
+ *   streaming line reader, and keeps them for every file it takes from
+ *   the shared queue, so after the first few files a worker allocates
+ *   almost nothing. When every file is done a report of per-file times
+ *   and byte counts is printed to stderr.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "batch.h"
+
+/* What happened to one file */
+struct Result {
+    char *output;
+    long bytesIn;
+    long bytesOut;
+    int rows;
+    double seconds;
+    const char *error;
+};
+
+/* The queue of files, shared by every worker */
+struct Queue {
+    pthread_mutex_t lock;
+    int next;
+    char **filenames;
+    int numFiles;
+    const char *outdir;
+    const struct RestoreOptions *options;
+    struct Result *results;
+};
+
+/* An output name and the file of the batch it belongs to */
+struct Output {
+    const char *name;
+    int index;
+};
+
+static bool outputsClash(struct Queue *queue);
+static int compareOutputs(const void *a, const void *b);
+static void *worker(void *cl);
+static void restoreOne(struct Queue *queue, int index,
+                       struct Restoration *run, Linereader_T *stream);
+static double now(void);
+static void report(struct Queue *queue);
+
+/* restoreBatch
+ *
+ *    Purpose: Restore many files at once, each to its own output file
+ * Parameters: The input file names and how many, the directory for the
+ *             outputs (NULL to put each next to its input), the number of
+ *             worker threads, and the options for each run
+ *    Returns: The number of files that could not be restored (all of
+ *             them if two would be written to the same output)
+*/
+int restoreBatch(char **filenames, int numFiles, const char *outdir,
+                 int workers, const struct RestoreOptions *options)
+{
+    assert(filenames != NULL && options != NULL);
+    if (workers < 1) {
+        workers = 1;
+    }
+    if (workers > numFiles) {
+        workers = numFiles > 0 ? numFiles : 1;
+    }
+
+    struct Queue queue;
+    pthread_mutex_init(&queue.lock, NULL);
+    queue.next = 0;
+    queue.filenames = filenames;
+    queue.numFiles = numFiles;
+    queue.outdir = outdir;
+    queue.options = options;
+    queue.results = calloc(numFiles > 0 ? numFiles : 1,
+                           sizeof(struct Result));
+    assert(queue.results != NULL);
+    for (int i = 0; i < numFiles; i++) {
+        queue.results[i].output = outputName(filenames[i], outdir);
+    }
+    if (outputsClash(&queue)) {
+        for (int i = 0; i < numFiles; i++) {
+            free(queue.results[i].output);
+        }
+        free(queue.results);
+        pthread_mutex_destroy(&queue.lock);
+        return numFiles;
+    }
+
+    pthread_t *threads = malloc(workers * sizeof(pthread_t));
+    assert(threads != NULL);
+    for (int i = 0; i < workers; i++) {
+        int failed = pthread_create(&threads[i], NULL, worker, &queue);
+        assert(failed == 0);
+    }
+    for (int i = 0; i < workers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    report(&queue);
+
+    int failures = 0;
+    for (int i = 0; i < numFiles; i++) {
+        failures += queue.results[i].error != NULL;
+        free(queue.results[i].output);
+    }
+    free(queue.results);
+    free(threads);
+    pthread_mutex_destroy(&queue.lock);
+    return failures;
+}
+
+/* outputName
+ *
+ *    Purpose: Work out where the restored version of a file goes: the
+ *             same name with ".pgm" (if any) replaced by ".restored.pgm",
+ *             in outdir if one is given and next to the input otherwise
+ * Parameters: The input file name and the output directory (or NULL)
+ *    Returns: A newly malloc'd path
+*/
+char *outputName(const char *filename, const char *outdir)
+{
+    const char *base = filename;
+    const char *slash = strrchr(filename, '/');
+    if (outdir != NULL && slash != NULL) {
+        base = slash + 1;
+    }
+
+    size_t length = strlen(base);
+    if (length >= 4 && strcmp(base + length - 4, ".pgm") == 0) {
+        length -= 4;
+    }
+
+    size_t size = (outdir != NULL ? strlen(outdir) + 1 : 0) + length +
+                  sizeof(".restored.pgm");
+    char *name = malloc(size);
+    assert(name != NULL);
+    snprintf(name, size, "%s%s%.*s.restored.pgm",
+             outdir != NULL ? outdir : "", outdir != NULL ? "/" : "",
+             (int)length, base);
+    return name;
+}
+
+/* outputsClash
+ *
+ *    Purpose: Check that no two files of the batch would be restored to
+ *             the same output (the same input named twice, or two inputs
+ *             of one name in different directories when there is an
+ *             outdir), since their workers would write it at once
+ * Parameters: The queue, with every output name filled in
+ *    Returns: True, after printing the clash to stderr, if two outputs are
+ *             the same
+*/
+static bool outputsClash(struct Queue *queue)
+{
+    int numFiles = queue->numFiles;
+    struct Output *outputs = malloc((numFiles > 0 ? numFiles : 1) *
+                                    sizeof(struct Output));
+    assert(outputs != NULL);
+    for (int i = 0; i < numFiles; i++) {
+        outputs[i].name = queue->results[i].output;
+        outputs[i].index = i;
+    }
+    qsort(outputs, numFiles, sizeof(struct Output), compareOutputs);
+
+    bool clash = false;
+    for (int i = 1; i < numFiles && !clash; i++) {
+        if (strcmp(outputs[i - 1].name, outputs[i].name) == 0) {
+            fprintf(stderr, "restoration: %s and %s would both be "
+                    "restored to %s\n",
+                    queue->filenames[outputs[i - 1].index],
+                    queue->filenames[outputs[i].index], outputs[i].name);
+            clash = true;
+        }
+    }
+    free(outputs);
+    return clash;
+}
+
+/* compareOutputs
+ *
+ *    Purpose: Order outputs by name, then by their place in the batch
+ * Parameters: Two outputs
+ *    Returns: Less than, equal to or greater than 0, as for qsort
+*/
+static int compareOutputs(const void *a, const void *b)
+{
+    const struct Output *first = a;
+    const struct Output *second = b;
+    int order = strcmp(first->name, second->name);
+    if (order != 0) {
+        return order;
+    }
+    return first->index - second->index;
+}
+
+/* worker
+ *
+ *    Purpose: Take files off the queue until there are none left
+ * Parameters: The queue
+ *    Returns: NULL
+*/
+static void *worker(void *cl)
+{
+    struct Queue *queue = cl;
+    struct Restoration run;
+    Linereader_T stream = NULL;
+    initRestoration(&run);
+
+    for (;;) {
+        pthread_mutex_lock(&queue->lock);
+        int index = queue->next++;
+        pthread_mutex_unlock(&queue->lock);
+        if (index >= queue->numFiles) {
+            break;
+        }
+        restoreOne(queue, index, &run, &stream);
+    }
+
+    if (stream != NULL) {
+        Linereader_free(&stream);
+    }
+    freeRestoration(&run);
+    return NULL;
+}
+
+/* restoreOne
+ *
+ *    Purpose: Restore one file of the batch and record how it went
+ * Parameters: The queue, the index of the file, the worker's restoration
+ *             state, and the worker's streaming reader (made the first
+ *             time a file cannot be mapped)
+ *    Returns: None
+*/
+static void restoreOne(struct Queue *queue, int index,
+                       struct Restoration *run, Linereader_T *stream)
+{
+    struct Result *result = &queue->results[index];
+    const char *filename = queue->filenames[index];
+    double start = now();
+
+    FILE *output = fopen(result->output, "wb");
+    if (output == NULL) {
+        result->error = "cannot open output";
+        return;
+    }
+
+    Linereader_T reader = Linereader_map(filename);
+    FILE *input = NULL;
+    if (reader == NULL) {
+        input = fopen(filename, "rb");
+        if (input == NULL) {
+            fclose(output);
+            remove(result->output);
+            result->error = "cannot open input";
+            return;
+        }
+        if (*stream == NULL) {
+            *stream = Linereader_new(input, 0);
+        } else {
+            Linereader_reset(*stream, input);
+        }
+    }
+
+    Linereader_T lines = reader != NULL ? reader : *stream;
+    result->bytesIn = Linereader_size(lines);
+    result->rows = restoreLines(run, lines, queue->options, output);
+    if (result->rows == 0) {
+        result->error = "no original rows found";
+    }
+
+    result->bytesOut = ftell(output);
+    fclose(output);
+    if (result->error != NULL) {
+        remove(result->output);
+    }
+    if (reader != NULL) {
+        Linereader_free(&reader);
+    } else {
+        fclose(input);
+    }
+    result->seconds = now() - start;
+}
+
+/* now
+ *
+ *    Purpose: Read the monotonic clock
+ * Parameters: None
+ *    Returns: The time in seconds
+*/
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* report
+ *
+ *    Purpose: Print a line per file and a total to stderr
+ * Parameters: The finished queue
+ *    Returns: None
+*/
+static void report(struct Queue *queue)
+{
+    long totalIn = 0;
+    long totalOut = 0;
+    double totalSeconds = 0;
+
+    fprintf(stderr, "%-40s %12s %12s %8s %10s\n", "file", "bytes in",
+            "bytes out", "rows", "seconds");
+    for (int i = 0; i < queue->numFiles; i++) {
+        struct Result *result = &queue->results[i];
+        if (result->error != NULL) {
+            fprintf(stderr, "%-40s %s\n", queue->filenames[i],
+                    result->error);
+            continue;
+        }
+        fprintf(stderr, "%-40s %12ld %12ld %8d %10.4f\n",
+                queue->filenames[i], result->bytesIn, result->bytesOut,
+                result->rows, result->seconds);
+        totalIn += result->bytesIn;
+        totalOut += result->bytesOut;
+        totalSeconds += result->seconds;
+    }
+    fprintf(stderr, "%-40s %12ld %12ld %8s %10.4f\n", "total", totalIn,
+            totalOut, "", totalSeconds);
+}
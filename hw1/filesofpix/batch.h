@@ -0,0 +1,19 @@
+/* 
+ *   batch.h
+ *   by: Drew Maynard and Joel Brandinger, 01/27/21
+ *   Files, Pictures and Interfaces
+ *
+ *   This file contains the interface for batch restoration: many files
+ *   restored concurrently by a fixed pool of worker threads.
+*/
+
+#ifndef BATCH_INCLUDED
+#define BATCH_INCLUDED
+
+#include "uncorrupt.h"
+
+int restoreBatch(char **filenames, int numFiles, const char *outdir,
+                 int workers, const struct RestoreOptions *options);
+char *outputName(const char *filename, const char *outdir);
+
+#endif
@@ -0,0 +1,258 @@
+/*
+ *   benchrestore.c
+ *   by: Drew Maynard and Joel Brandinger, 01/27/21
+ *   Files, Pictures and Interfaces
+ *
+ *   This file times restoration on a corrupted image.
+ *
+ *   Usage: benchrestore [-r runs] [-x restoration] file [options...]
+ *
+ *     -r    how many times to run restoration (default 3); the fastest
+ *           run is reported
+ *     -x    the restoration program to run (default ./restoration)
+ *
+ *   Any options after the file are passed on to restoration. The image is
+ *   thrown away. The report gives the throughput in MB/s and lines/s, the
+ *   peak resident set size (from wait4), the number of distinct patterns
+ *   and how full the fingerprint table got, and the time, number of mallocs
+ *   and bytes allocated in each phase of the run, which restoration prints
+ *   when RESTORATION_STATS is set, along with how long its parser and its
+ *   background reader (-p) waited for each other.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define DEFAULT_RUNS 3
+#define REPORT_SIZE 4096
+
+static const char *phases[] = { "read", "hash", "parse", "emit" };
+#define NUM_PHASES (sizeof(phases) / sizeof(phases[0]))
+
+struct Run {
+    double seconds;
+    long peakKilobytes;
+    char report[REPORT_SIZE];
+};
+
+static uint64_t countLines(const char *filename, uint64_t *bytes);
+static void runOnce(char **args, struct Run *run);
+static double phaseValue(const char *report, const char *phase,
+                         const char *field);
+static double now(void);
+static void usage(char *program);
+
+int main(int argc, char **argv)
+{
+    int runs = DEFAULT_RUNS;
+    char *program = "./restoration";
+    int i = 1;
+
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-x") == 0 && i + 1 < argc) {
+            program = argv[++i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (i >= argc || runs < 1) {
+        usage(argv[0]);
+    }
+    char *filename = argv[i++];
+
+    /* restoration [options...] file */
+    char **args = malloc((argc - i + 3) * sizeof(*args));
+    assert(args != NULL);
+    int numArgs = 0;
+    args[numArgs++] = program;
+    for (; i < argc; i++) {
+        args[numArgs++] = argv[i];
+    }
+    args[numArgs++] = filename;
+    args[numArgs] = NULL;
+
+    uint64_t bytes;
+    uint64_t lines = countLines(filename, &bytes);
+
+    struct Run best, current;
+    best.seconds = -1;
+    for (int r = 0; r < runs; r++) {
+        runOnce(args, &current);
+        if (best.seconds < 0 || current.seconds < best.seconds) {
+            best = current;
+        }
+    }
+
+    printf("file        %s\n", filename);
+    printf("bytes       %llu\n", (unsigned long long)bytes);
+    printf("lines       %llu\n", (unsigned long long)lines);
+    printf("runs        %d (fastest reported)\n", runs);
+    printf("seconds     %.4f\n", best.seconds);
+    printf("MB/s        %.1f\n", bytes / 1e6 / best.seconds);
+    printf("lines/s     %.0f\n", lines / best.seconds);
+    printf("peak RSS    %.1f MB\n", best.peakKilobytes / 1024.0);
+    printf("patterns    %.0f (table load %.2f)\n",
+           phaseValue(best.report, "table", "patterns"),
+           phaseValue(best.report, "table", "load"));
+    printf("%-12s %10s %10s %14s\n", "phase", "seconds", "mallocs",
+           "bytes");
+    for (size_t p = 0; p < NUM_PHASES; p++) {
+        printf("%-12s %10.4f %10.0f %14.0f\n", phases[p],
+               phaseValue(best.report, phases[p], "seconds"),
+               phaseValue(best.report, phases[p], "mallocs"),
+               phaseValue(best.report, phases[p], "bytes"));
+    }
+    printf("parser waited on input  %.4f s\n",
+           phaseValue(best.report, "waits", "parser"));
+    printf("reader waited on parser %.4f s\n",
+           phaseValue(best.report, "waits", "reader"));
+
+    free(args);
+    return EXIT_SUCCESS;
+}
+
+/* countLines
+ *
+ *    Purpose: Count the lines of a file (a last line without a newline
+ *             counts too)
+ * Parameters: The name of the file and where to put its size in bytes
+ *    Returns: The number of lines
+*/
+static uint64_t countLines(const char *filename, uint64_t *bytes)
+{
+    FILE *fp = fopen(filename, "rb");
+    if (fp == NULL) {
+        fprintf(stderr, "benchrestore: cannot open %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    static char buffer[1 << 16];
+    uint64_t lines = 0;
+    size_t n;
+    char last = '\n';
+    *bytes = 0;
+    while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+        for (const char *p = buffer;
+             (p = memchr(p, '\n', buffer + n - p)) != NULL; p++) {
+            lines++;
+        }
+        last = buffer[n - 1];
+        *bytes += n;
+    }
+    fclose(fp);
+    return last == '\n' ? lines : lines + 1;
+}
+
+/* runOnce
+ *
+ *    Purpose: Run restoration once with its statistics turned on, sending
+ *             the image to /dev/null and keeping what it says on stderr
+ * Parameters: The command line and where to put the results of the run
+ *    Returns: None
+*/
+static void runOnce(char **args, struct Run *run)
+{
+    int report[2];
+    int failed = pipe(report);
+    assert(failed == 0);
+
+    double start = now();
+    pid_t child = fork();
+    assert(child >= 0);
+    if (child == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        dup2(report[1], STDERR_FILENO);
+        close(report[0]);
+        setenv("RESTORATION_STATS", "1", 1);
+        execv(args[0], args);
+        fprintf(stderr, "benchrestore: cannot run %s\n", args[0]);
+        _exit(127);
+    }
+    close(report[1]);
+
+    size_t used = 0;
+    ssize_t n;
+    while ((n = read(report[0], run->report + used,
+                     REPORT_SIZE - 1 - used)) > 0) {
+        used += n;
+    }
+    run->report[used] = '\0';
+    close(report[0]);
+
+    int status;
+    struct rusage usage;
+    wait4(child, &status, 0, &usage);
+    run->seconds = now() - start;
+    run->peakKilobytes = usage.ru_maxrss;
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "benchrestore: %s failed:\n%s", args[0],
+                run->report);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* phaseValue
+ *
+ *    Purpose: Pull one number for one phase out of restoration's report,
+ *             which looks like {"phases":{"read":{"seconds":...},...}}
+ * Parameters: The report, the phase and the name of the number
+ *    Returns: The number, or 0 if it is not in the report
+*/
+static double phaseValue(const char *report, const char *phase,
+                         const char *field)
+{
+    char key[64];
+    snprintf(key, sizeof(key), "\"%s\":{", phase);
+    const char *p = strstr(report, key);
+    if (p == NULL) {
+        return 0;
+    }
+    const char *end = strchr(p, '}');
+    snprintf(key, sizeof(key), "\"%s\":", field);
+    p = strstr(p, key);
+    if (p == NULL || p > end) {
+        return 0;
+    }
+    return atof(p + strlen(key));
+}
+
+/* now
+ *
+ *    Purpose: Read the monotonic clock
+ * Parameters: None
+ *    Returns: The time in seconds
+*/
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* usage
+ *
+ *    Purpose: Explain how to run benchrestore and quit
+ * Parameters: The name of the program
+ *    Returns: None
+*/
+static void usage(char *program)
+{
+    fprintf(stderr, "Usage: %s [-r runs] [-x restoration] file "
+                    "[options...]\n", program);
+    exit(EXIT_FAILURE);
+}
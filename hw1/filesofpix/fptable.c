@@ -0,0 +1,379 @@
+/* 
+ *   fptable.c
+ *   by: Drew Maynard and Joel Brandinger, 01/27/21
+ *   Files, Pictures and Interfaces
+ *
+ *   This file contains the implementation of the fingerprint table. Slots
+ *   are probed linearly from the low bits of the 64-bit fingerprint, and
+ *   the table doubles once it is half full. Old slot arrays are left in
+ *   the arena, which costs at most as much again as the final array.
+ *
+ *   A slot refers either to a pattern or to a whole line with that
+ *   pattern. Once a pattern is seen a second time the caller has split the
+ *   line anyway, so the slot is moved over to the bare pattern and every
+ *   later comparison is a memcmp.
+*/
+
+#include <string.h>
+#include <assert.h>
+#include "fptable.h"
+
+#define T Fptable_T
+
+struct Slot {
+    uint64_t hash;
+    const char *pattern;
+    size_t bytes;
+    size_t length;
+    void *value;
+};
+
+struct T {
+    Arena_T arena;
+    struct Slot *slots;
+    size_t capacity;
+    size_t length;
+};
+
+static struct Slot *newSlots(Arena_T arena, size_t capacity);
+static struct Slot *probe(T table, uint64_t hash, const char *pattern,
+                          size_t bytes, size_t length);
+static void grow(T table);
+static const char *copyBytes(T table, const char *bytes, size_t length);
+static uint64_t load64(const char *bytes);
+
+/* Fptable_new
+ *
+ *    Purpose: Create an empty fingerprint table in an arena
+ * Parameters: The arena and the number of distinct patterns expected
+ *    Returns: A pointer to the new table
+*/
+extern T Fptable_new(Arena_T arena, size_t hint)
+{
+    assert(arena != NULL);
+    size_t capacity = 16;
+    while (capacity < hint * 2) {
+        capacity = capacity * 2;
+    }
+
+    T table = Arena_alloc(arena, sizeof(struct T));
+    table->arena = arena;
+    table->slots = newSlots(arena, capacity);
+    table->capacity = capacity;
+    table->length = 0;
+    return table;
+}
+
+/* Fptable_hash
+ *
+ *    Purpose: Compute the 64-bit fingerprint of a pattern
+ * Parameters: The pattern bytes and how many there are
+ *    Returns: The fingerprint, made 8 bytes at a time by Fptable_step
+*/
+extern uint64_t Fptable_hash(const char *pattern, size_t length)
+{
+    uint64_t hash = FPTABLE_SEED;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        hash = Fptable_step(hash, load64(pattern + i));
+    }
+
+    uint64_t word = 0;
+    for (size_t k = 0; i + k < length; k++) {
+        word |= (uint64_t)(unsigned char)pattern[i + k] << (8 * k);
+    }
+    return Fptable_finish(hash, word, length);
+}
+
+/* Fptable_linehash
+ *
+ *    Purpose: Compute the fingerprint of a line's pattern in the same pass
+ *             that finds its digits, without storing the pattern
+ * Parameters: The line, its length, and a reference that is set to the
+ *             number of non-digits in it
+ *    Returns: The same fingerprint Fptable_hash gives for the pattern
+*/
+extern uint64_t Fptable_linehash(const char *line, size_t bytes,
+                                 size_t *length)
+{
+    uint64_t hash = FPTABLE_SEED;
+    uint64_t word = 0;
+    unsigned filled = 0;
+    size_t n = 0;
+
+    for (size_t i = 0; i < bytes; i++) {
+        unsigned char c = line[i];
+        /* Digits and non-digits are mixed too finely for a branch on
+           each byte to be predicted, so every byte goes through the
+           same steps and a digit just adds nothing */
+        unsigned keep = (unsigned)(c - '0') > 9;
+        word |= (uint64_t)(c * keep) << (8 * filled);
+        filled += keep;
+        n += keep;
+        if (filled == 8) {
+            hash = Fptable_step(hash, word);
+            word = 0;
+            filled = 0;
+        }
+    }
+
+    *length = n;
+    return Fptable_finish(hash, word, n);
+}
+
+/* Fptable_equal
+ *
+ *    Purpose: Tell whether two lines (or patterns) have the same pattern,
+ *             skipping the digits of both
+ * Parameters: The first line and its length, the second and its length
+ *    Returns: True if their non-digit bytes are the same
+*/
+extern bool Fptable_equal(const char *a, size_t aBytes, const char *b,
+                          size_t bBytes)
+{
+    if (aBytes == bBytes && memcmp(a, b, aBytes) == 0) {
+        return true;
+    }
+
+    size_t i = 0;
+    size_t j = 0;
+    for (;;) {
+        while (i < aBytes && (unsigned)((unsigned char)a[i] - '0') <= 9) {
+            i++;
+        }
+        while (j < bBytes && (unsigned)((unsigned char)b[j] - '0') <= 9) {
+            j++;
+        }
+        if (i == aBytes || j == bBytes) {
+            return i == aBytes && j == bBytes;
+        }
+        if (a[i] != b[j]) {
+            return false;
+        }
+        i++;
+        j++;
+    }
+}
+
+/* Fptable_has
+ *
+ *    Purpose: Tell whether a pattern with this fingerprint and length may
+ *             be in the table, without comparing any bytes
+ * Parameters: The table, the fingerprint and the length of the pattern
+ *    Returns: True if some pattern in the table has the same fingerprint
+ *             and length
+*/
+extern bool Fptable_has(T table, uint64_t hash, size_t length)
+{
+    assert(table != NULL);
+    size_t mask = table->capacity - 1;
+
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        struct Slot *slot = &table->slots[i];
+        if (slot->pattern == NULL) {
+            return false;
+        }
+        if (slot->hash == hash && slot->length == length) {
+            return true;
+        }
+    }
+}
+
+/* Fptable_slot
+ *
+ *    Purpose: Find the value slot of a pattern, adding a copy of the
+ *             pattern (with a NULL value) if it is not in the table yet
+ * Parameters: The table, the pattern and its length, and a reference that
+ *             is set to whether the pattern was already there
+ *    Returns: A pointer to the value stored for the pattern. It is only
+ *             valid until the next pattern is added.
+*/
+extern void **Fptable_slot(T table, const char *pattern, size_t length,
+                           bool *found)
+{
+    return Fptable_hashslot(table, Fptable_hash(pattern, length), pattern,
+                            length, length, true, found);
+}
+
+/* Fptable_hashslot
+ *
+ *    Purpose: Find the value slot of a pattern whose fingerprint is already
+ *             known, adding it (with a NULL value) if it is not in the
+ *             table yet. The pattern may be given as a whole line. When a
+ *             slot that refers to a line is found with a bare pattern, the
+ *             slot is moved over to the pattern.
+ * Parameters: The table, the fingerprint, the pattern (or line), its length
+ *             in bytes and its number of non-digits, whether to keep a
+ *             copy of it (if not, it must outlive the table), and a
+ *             reference that is set to whether the pattern was already
+ *             there
+ *    Returns: A pointer to the value stored for the pattern. It is only
+ *             valid until the next pattern is added.
+*/
+extern void **Fptable_hashslot(T table, uint64_t hash, const char *pattern,
+                               size_t bytes, size_t length, bool copy,
+                               bool *found)
+{
+    assert(table != NULL && found != NULL);
+    struct Slot *slot = probe(table, hash, pattern, bytes, length);
+
+    *found = slot->pattern != NULL;
+    if (*found) {
+        if (slot->bytes != slot->length && bytes == length) {
+            slot->pattern = copy ? copyBytes(table, pattern, length)
+                                 : pattern;
+            slot->bytes = length;
+        }
+        return &slot->value;
+    }
+
+    if (2 * (table->length + 1) > table->capacity) {
+        grow(table);
+        slot = probe(table, hash, pattern, bytes, length);
+    }
+
+    slot->hash = hash;
+    slot->pattern = copy ? copyBytes(table, pattern, bytes) : pattern;
+    slot->bytes = bytes;
+    slot->length = length;
+    slot->value = NULL;
+    table->length++;
+    return &slot->value;
+}
+
+/* Fptable_get
+ *
+ *    Purpose: Look up the value stored for a pattern
+ * Parameters: The table and the pattern and its length
+ *    Returns: The value, or NULL if the pattern is not in the table
+*/
+extern void *Fptable_get(T table, const char *pattern, size_t length)
+{
+    assert(table != NULL);
+    struct Slot *slot = probe(table, Fptable_hash(pattern, length),
+                              pattern, length, length);
+    return slot->pattern != NULL ? slot->value : NULL;
+}
+
+/* Fptable_length
+ *
+ *    Purpose: Get the number of distinct patterns in the table
+ * Parameters: The table
+ *    Returns: The number of patterns
+*/
+extern size_t Fptable_length(T table)
+{
+    assert(table != NULL);
+    return table->length;
+}
+
+/* Fptable_capacity
+ *
+ *    Purpose: Get the number of slots, to see how full the table is
+ * Parameters: The table
+ *    Returns: The number of slots
+*/
+extern size_t Fptable_capacity(T table)
+{
+    assert(table != NULL);
+    return table->capacity;
+}
+
+/* probe
+ *
+ *    Purpose: Walk the probe sequence of a fingerprint
+ * Parameters: The table, the fingerprint, and the pattern (or line) it
+ *             came from, its length in bytes and its number of non-digits
+ *    Returns: The slot holding the pattern, or the empty slot where it
+ *             would go
+*/
+static struct Slot *probe(T table, uint64_t hash, const char *pattern,
+                          size_t bytes, size_t length)
+{
+    size_t mask = table->capacity - 1;
+    size_t i = hash & mask;
+
+    for (;;) {
+        struct Slot *slot = &table->slots[i];
+        if (slot->pattern == NULL) {
+            return slot;
+        }
+        if (slot->hash == hash && slot->length == length &&
+            Fptable_equal(slot->pattern, slot->bytes, pattern, bytes)) {
+            return slot;
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+/* grow
+ *
+ *    Purpose: Double the number of slots and re-place every pattern
+ * Parameters: The table
+ *    Returns: None
+*/
+static void grow(T table)
+{
+    struct Slot *old = table->slots;
+    size_t oldCapacity = table->capacity;
+
+    table->capacity = oldCapacity * 2;
+    table->slots = newSlots(table->arena, table->capacity);
+    size_t mask = table->capacity - 1;
+
+    for (size_t i = 0; i < oldCapacity; i++) {
+        if (old[i].pattern == NULL) {
+            continue;
+        }
+        size_t j = old[i].hash & mask;
+        while (table->slots[j].pattern != NULL) {
+            j = (j + 1) & mask;
+        }
+        table->slots[j] = old[i];
+    }
+}
+
+/* newSlots
+ *
+ *    Purpose: Allocate an array of empty slots in the arena
+ * Parameters: The arena and the number of slots
+ *    Returns: A pointer to the slots
+*/
+static struct Slot *newSlots(Arena_T arena, size_t capacity)
+{
+    struct Slot *slots = Arena_alloc(arena, capacity * sizeof(struct Slot));
+    memset(slots, 0, capacity * sizeof(struct Slot));
+    return slots;
+}
+
+/* copyBytes
+ *
+ *    Purpose: Keep a copy of a pattern (or line) in the table's arena
+ * Parameters: The table, the bytes and how many there are
+ *    Returns: The copy, with a '\0' after it
+*/
+static const char *copyBytes(T table, const char *bytes, size_t length)
+{
+    char *copy = Arena_alloc(table->arena, length + 1);
+    memcpy(copy, bytes, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+/* load64
+ *
+ *    Purpose: Read 8 bytes as a little-endian word
+ * Parameters: The bytes (which need not be aligned)
+ *    Returns: The word
+*/
+static uint64_t load64(const char *bytes)
+{
+    uint64_t word;
+    memcpy(&word, bytes, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+#undef T
@@ -0,0 +1,83 @@
+/*
+ *   fptable.h
+ *   by: Drew Maynard and Joel Brandinger, 01/27/21
+ *   Files, Pictures and Interfaces
+ *
+ *   This file contains the interface for the fingerprint table, an open
+ *   addressing hash table that maps the non-digit pattern of a line to a
+ *   value. Each pattern is hashed once to 64 bits; the bytes are only
+ *   compared when two fingerprints are equal. The table and its copies of
+ *   the patterns live in an arena and go away with it.
+ *
+ *   A pattern can also be given as the whole line it came from, digits
+ *   and all, with its fingerprint and length worked out in the same pass
+ *   that finds the digits (Fptable_linehash, or the fused scanners in
+ *   linescan.c). That way a line that is never repeated is never split:
+ *   the table just refers to it, and Fptable_has tells the caller when a
+ *   line is worth splitting to compare it exactly.
+ *
+ *   The fingerprint works on the pattern 8 bytes at a time; Fptable_step
+ *   and Fptable_finish are here so that every implementation of it agrees.
+*/
+
+#ifndef FPTABLE_INCLUDED
+#define FPTABLE_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+
+#define T Fptable_T
+typedef struct T *T;
+
+#define FPTABLE_SEED 0x243F6A8885A308D3ULL
+#define FPTABLE_MULTIPLIER 0x9E3779B97F4A7C15ULL
+
+extern T Fptable_new(Arena_T arena, size_t hint);
+
+extern uint64_t Fptable_hash(const char *pattern, size_t length);
+extern uint64_t Fptable_linehash(const char *line, size_t bytes,
+                                 size_t *length);
+extern bool Fptable_equal(const char *a, size_t aBytes, const char *b,
+                          size_t bBytes);
+extern bool Fptable_has(T table, uint64_t hash, size_t length);
+extern void **Fptable_slot(T table, const char *pattern, size_t length,
+                           bool *found);
+extern void **Fptable_hashslot(T table, uint64_t hash, const char *pattern,
+                               size_t bytes, size_t length, bool copy,
+                               bool *found);
+extern void *Fptable_get(T table, const char *pattern, size_t length);
+extern size_t Fptable_length(T table);
+extern size_t Fptable_capacity(T table);
+
+/* Fptable_step
+ *
+ *    Purpose: Mix the next 8 pattern bytes into a fingerprint
+ * Parameters: The fingerprint so far and the bytes, as a little-endian
+ *             word
+ *    Returns: The new fingerprint
+*/
+static inline uint64_t Fptable_step(uint64_t hash, uint64_t word)
+{
+    hash = (hash ^ word) * FPTABLE_MULTIPLIER;
+    return hash ^ (hash >> 29);
+}
+
+/* Fptable_finish
+ *
+ *    Purpose: Mix in the last 0 to 7 pattern bytes and the length
+ * Parameters: The fingerprint so far, the last bytes as a little-endian
+ *             word padded with zeros, and the length of the pattern
+ *    Returns: The fingerprint of the pattern
+*/
+static inline uint64_t Fptable_finish(uint64_t hash, uint64_t word,
+                                      size_t length)
+{
+    hash = Fptable_step(hash, word) ^ length;
+    hash *= FPTABLE_MULTIPLIER;
+    return hash ^ (hash >> 32);
+}
+
+#undef T
+#endif
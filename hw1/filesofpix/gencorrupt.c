@@ -0,0 +1,331 @@
+/*
+ *   gencorrupt.c
+ *   by: Drew Maynard and Joel Brandinger, 01/27/21
+ *   Files, Pictures and Interfaces
+ *
+ *   This file makes corrupted P2 images for testing and timing restoration.
+ *
+ *   Usage: gencorrupt [-b bytes] [-j ratio] [-d density] [-r seed]
+ *                     [-w width] [-h height] [clean.pgm]
+ *
+ *     -b    make the output at least this big by repeating the rows of
+ *           the image (it is always written at least once)
+ *     -j    the fraction of all lines that are junk (default 0.5)
+ *     -d    the fraction of bytes that are digits (default 0.3); lower
+ *           densities mean longer runs of non-digits between the pixels
+ *     -r    the seed for the random numbers (default 1)
+ *     -w -h the size of the random image made when no clean image is
+ *           given (default 256 by 256)
+ *
+ *   The corrupted image is written to stdout. Every original row is
+ *   written with the same non-digit bytes around its pixels and every
+ *   junk line gets different ones, so restoring the output gives back the
+ *   clean image (repeated to fill the size asked for).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "pnmrdr.h"
+
+#define BUFSIZE (1 << 20)
+#define DIGITS_PER_PIXEL 2.6
+
+struct Generator {
+    uint64_t state;
+    int meanSeparator;
+    char buffer[BUFSIZE];
+    size_t used;
+    size_t written;
+};
+
+static void readImage(FILE *fp, uint8_t **pixels, int *width, int *height);
+static void randomImage(struct Generator *gen, uint8_t **pixels, int width,
+                        int height);
+static char *makeSeparator(struct Generator *gen, int *length);
+static char nonDigit(struct Generator *gen);
+static void writeRow(struct Generator *gen, const uint8_t *pixels, int width,
+                     char **separators, int *lengths);
+static void writeJunk(struct Generator *gen, int width, uint64_t index);
+static void put(struct Generator *gen, const char *bytes, size_t length);
+static void flush(struct Generator *gen);
+static uint64_t nextRandom(struct Generator *gen);
+static void usage(char *program);
+
+int main(int argc, char **argv)
+{
+    size_t target = 0;
+    double ratio = 0.5;
+    double density = 0.3;
+    uint64_t seed = 1;
+    int width = 256;
+    int height = 256;
+    char *filename = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            target = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            ratio = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            density = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            width = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-h") == 0 && i + 1 < argc) {
+            height = atoi(argv[++i]);
+        } else if (argv[i][0] == '-' || filename != NULL) {
+            usage(argv[0]);
+        } else {
+            filename = argv[i];
+        }
+    }
+    if (ratio < 0 || ratio >= 1 || density <= 0 || density > 1 ||
+        width < 1 || height < 1) {
+        usage(argv[0]);
+    }
+
+    struct Generator *gen = malloc(sizeof(*gen));
+    assert(gen != NULL);
+    gen->state = seed * 0x9E3779B97F4A7C15ull + 1;
+    gen->meanSeparator = DIGITS_PER_PIXEL * (1 - density) / density + 0.5;
+    if (gen->meanSeparator < 1) {
+        gen->meanSeparator = 1;
+    }
+    gen->used = 0;
+    gen->written = 0;
+
+    uint8_t *pixels;
+    if (filename != NULL) {
+        FILE *fp = fopen(filename, "rb");
+        if (fp == NULL) {
+            fprintf(stderr, "%s: cannot open %s\n", argv[0], filename);
+            exit(EXIT_FAILURE);
+        }
+        readImage(fp, &pixels, &width, &height);
+        fclose(fp);
+    } else {
+        randomImage(gen, &pixels, width, height);
+    }
+
+    /* The separators of the original rows; the first one starts with a
+       byte no junk line starts with */
+    char **separators = malloc((width + 1) * sizeof(*separators));
+    int *lengths = malloc((width + 1) * sizeof(*lengths));
+    assert(separators != NULL && lengths != NULL);
+    for (int i = 0; i <= width; i++) {
+        separators[i] = makeSeparator(gen, &lengths[i]);
+    }
+    separators[0][0] = (char)0xFF;
+
+    /* Junk lines per original row, in 1/65536ths */
+    uint64_t junkPerRow = ratio / (1 - ratio) * 65536;
+    uint64_t owed = 0;
+    uint64_t junkLines = 0;
+    for (uint64_t row = 0; row < (uint64_t)height ||
+                           gen->written + gen->used < target; row++) {
+        owed += junkPerRow;
+        while (owed >= 65536) {
+            writeJunk(gen, width, junkLines++);
+            owed -= 65536;
+        }
+        writeRow(gen, pixels + (row % height) * width, width,
+                 separators, lengths);
+    }
+    flush(gen);
+
+    for (int i = 0; i <= width; i++) {
+        free(separators[i]);
+    }
+    free(separators);
+    free(lengths);
+    free(pixels);
+    free(gen);
+    return EXIT_SUCCESS;
+}
+
+/* readImage
+ *
+ *    Purpose: Read a clean graymap, clamping pixels to 255
+ * Parameters: The open file, and where to put the pixels, width and height
+ *    Returns: None
+*/
+static void readImage(FILE *fp, uint8_t **pixels, int *width, int *height)
+{
+    Pnmrdr_T rdr = Pnmrdr_new(fp);
+    Pnmrdr_mapdata data = Pnmrdr_data(rdr);
+    assert(data.type == Pnmrdr_gray);
+    assert(data.width > 0 && data.height > 0);
+
+    *width = data.width;
+    *height = data.height;
+    *pixels = malloc((size_t)data.width * data.height);
+    assert(*pixels != NULL);
+    for (size_t i = 0; i < (size_t)data.width * data.height; i++) {
+        unsigned value = Pnmrdr_get(rdr);
+        (*pixels)[i] = value > 255 ? 255 : value;
+    }
+    Pnmrdr_free(&rdr);
+}
+
+/* randomImage
+ *
+ *    Purpose: Make an image of random pixels
+ * Parameters: The generator, where to put the pixels, and the size
+ *    Returns: None
+*/
+static void randomImage(struct Generator *gen, uint8_t **pixels, int width,
+                        int height)
+{
+    *pixels = malloc((size_t)width * height);
+    assert(*pixels != NULL);
+    for (size_t i = 0; i < (size_t)width * height; i++) {
+        (*pixels)[i] = nextRandom(gen) & 0xFF;
+    }
+}
+
+/* makeSeparator
+ *
+ *    Purpose: Make a random run of non-digit bytes (never a newline)
+ * Parameters: The generator and where to put the length of the run
+ *    Returns: The run, which the caller frees
+*/
+static char *makeSeparator(struct Generator *gen, int *length)
+{
+    *length = 1 + nextRandom(gen) % (2 * gen->meanSeparator - 1);
+    char *separator = malloc(*length);
+    assert(separator != NULL);
+    for (int i = 0; i < *length; i++) {
+        separator[i] = nonDigit(gen);
+    }
+    return separator;
+}
+
+/* nonDigit
+ *
+ *    Purpose: Pick a random byte that is neither a digit nor a newline
+ * Parameters: The generator
+ *    Returns: The byte
+*/
+static char nonDigit(struct Generator *gen)
+{
+    char c;
+    do {
+        c = nextRandom(gen) & 0xFF;
+    } while (c == '\n' || (c >= '0' && c <= '9'));
+    return c;
+}
+
+/* writeRow
+ *
+ *    Purpose: Write an original row with its pixels between the separators
+ * Parameters: The generator, the pixels and width of the row, and the
+ *             width + 1 separators and their lengths
+ *    Returns: None
+*/
+static void writeRow(struct Generator *gen, const uint8_t *pixels, int width,
+                     char **separators, int *lengths)
+{
+    char number[4];
+    for (int i = 0; i < width; i++) {
+        put(gen, separators[i], lengths[i]);
+        int digits = sprintf(number, "%d", pixels[i]);
+        put(gen, number, digits);
+    }
+    put(gen, separators[width], lengths[width]);
+    put(gen, "\n", 1);
+}
+
+/* writeJunk
+ *
+ *    Purpose: Write a junk line. It starts with 'j' and its index in
+ *             letters, ended by '.', so no two junk lines (and no junk line
+ *             and original row) have the same non-digit bytes.
+ * Parameters: The generator, the number of values on the line, and the
+ *             index of the junk line
+ *    Returns: None
+*/
+static void writeJunk(struct Generator *gen, int width, uint64_t index)
+{
+    char tag[16];
+    int length = 0;
+    tag[length++] = 'j';
+    do {
+        tag[length++] = 'a' + index % 26;
+        index /= 26;
+    } while (index > 0);
+    tag[length++] = '.';
+    put(gen, tag, length);
+
+    char number[4];
+    for (int i = 0; i < width; i++) {
+        int digits = sprintf(number, "%d", (int)(nextRandom(gen) & 0xFF));
+        put(gen, number, digits);
+        length = 1 + nextRandom(gen) % (2 * gen->meanSeparator - 1);
+        for (int j = 0; j < length; j++) {
+            char c = nonDigit(gen);
+            put(gen, &c, 1);
+        }
+    }
+    put(gen, "\n", 1);
+}
+
+/* put
+ *
+ *    Purpose: Add bytes to the output buffer, writing it out when full
+ * Parameters: The generator, the bytes and how many there are
+ *    Returns: None
+*/
+static void put(struct Generator *gen, const char *bytes, size_t length)
+{
+    if (gen->used + length > BUFSIZE) {
+        flush(gen);
+    }
+    memcpy(gen->buffer + gen->used, bytes, length);
+    gen->used += length;
+}
+
+/* flush
+ *
+ *    Purpose: Write out the output buffer
+ * Parameters: The generator
+ *    Returns: None
+*/
+static void flush(struct Generator *gen)
+{
+    size_t n = fwrite(gen->buffer, 1, gen->used, stdout);
+    assert(n == gen->used);
+    gen->written += gen->used;
+    gen->used = 0;
+}
+
+/* nextRandom
+ *
+ *    Purpose: Step the generator's xorshift64* random numbers
+ * Parameters: The generator
+ *    Returns: The next random number
+*/
+static uint64_t nextRandom(struct Generator *gen)
+{
+    gen->state ^= gen->state >> 12;
+    gen->state ^= gen->state << 25;
+    gen->state ^= gen->state >> 27;
+    return gen->state * 0x2545F4914F6CDD1Dull;
+}
+
+/* usage
+ *
+ *    Purpose: Explain how to run gencorrupt and quit
+ * Parameters: The name of the program
+ *    Returns: None
+*/
+static void usage(char *program)
+{
+    fprintf(stderr, "Usage: %s [-b bytes] [-j ratio] [-d density] "
+                    "[-r seed] [-w width] [-h height] [clean.pgm]\n",
+            program);
+    exit(EXIT_FAILURE);
+}
@@ -0,0 +1,667 @@
+/* 
+ *   linereader.c
+ *   by: Drew Maynard and Joel Brandinger, 01/27/21
+ *   Files, Pictures and Interfaces
+ *
+ *   This file contains the implementation of the line reader. The input is
+ *   read in large blocks into a single buffer, and each call scans forward
+ *   from the end of the previous line for the next '\n'. The buffer only
+ *   grows when a single line is longer than everything it can hold.
+ *
+ *   A mapped reader uses the mapping itself as its buffer: the whole file
+ *   is already "read", so fill never has anything to do.
+ *
+ *   Linereader_prefetch starts a thread that stays up to a given number of
+ *   blocks ahead of the parser. For a stream it reads blocks into a ring
+ *   that fill copies out of; for a mapping it touches every page of the
+ *   next blocks, and fill only lets the parser see the blocks that are in
+ *   memory. Either way the parser blocks on the ring, never on the disk,
+ *   and the time each side spent waiting for the other is kept.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "linereader.h"
+
+#define T Linereader_T
+#define DEFAULT_BUFSIZE (1 << 16)
+#define RELEASE_STEP (1 << 20)
+#define PREFETCH_BLOCK (1 << 20)
+
+/* The background reader. Blocks are handed over under the lock: for a
+ * stream, count filled blocks wait in the ring from head on; for a
+ * mapping, everything below ready has been touched and everything below
+ * taken has been shown to the parser. */
+struct Prefetch {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t filled;
+    pthread_cond_t drained;
+    int depth;
+    char **blocks;
+    size_t *lengths;
+    int head;
+    int count;
+    size_t ready;
+    size_t taken;
+    bool done;
+    bool stop;
+    double parserWait;
+    double readerWait;
+};
+
+struct T {
+    FILE *fp;
+    char *buffer;
+    size_t capacity;
+    size_t start;
+    size_t end;
+    size_t released;
+    bool eof;
+    bool mapped;
+    struct Prefetch *prefetch;
+};
+
+static bool fill(T reader);
+static bool fillPrefetched(T reader);
+static void *readAhead(void *closure);
+static void *touchAhead(void *closure);
+static void stopPrefetch(T reader);
+static double waitFor(pthread_cond_t *cond, pthread_mutex_t *lock);
+
+/* Linereader_new
+ *
+ *    Purpose: Create a line reader on top of an open input stream
+ * Parameters: The input stream and the size of the read buffer in bytes
+ *             (0 picks a default)
+ *    Returns: A pointer to the new reader
+*/
+extern T Linereader_new(FILE *fp, size_t bufsize)
+{
+    assert(fp != NULL);
+    if (bufsize == 0) {
+        bufsize = DEFAULT_BUFSIZE;
+    }
+
+    T reader = (void*)malloc(sizeof(struct T));
+    assert(reader != NULL);
+    reader->buffer = (char*) malloc(bufsize * sizeof(char));
+    assert(reader->buffer != NULL);
+
+    reader->fp = fp;
+    reader->capacity = bufsize;
+    reader->start = 0;
+    reader->end = 0;
+    reader->released = 0;
+    reader->eof = false;
+    reader->mapped = false;
+    reader->prefetch = NULL;
+    return reader;
+}
+
+/* Linereader_map
+ *
+ *    Purpose: Create a line reader over a memory mapping of a whole file,
+ *             so lines can be handed out without copying a single byte
+ * Parameters: The name of the file
+ *    Returns: A pointer to the new reader, or NULL if the file cannot be
+ *             mapped (pipes, terminals, empty files, ...). The caller is
+ *             expected to fall back to Linereader_new in that case.
+*/
+extern T Linereader_map(const char *filename)
+{
+    assert(filename != NULL);
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) ||
+        info.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = info.st_size;
+    char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    T reader = (void*)malloc(sizeof(struct T));
+    assert(reader != NULL);
+    reader->fp = NULL;
+    reader->buffer = data;
+    reader->capacity = size;
+    reader->start = 0;
+    reader->end = size;
+    reader->released = 0;
+    reader->eof = true;
+    reader->mapped = true;
+    reader->prefetch = NULL;
+    return reader;
+}
+
+/* Linereader_free
+ *
+ *    Purpose: Deallocate the reader and its buffer. The stream is left open.
+ * Parameters: A reference to the reader
+ *    Returns: None
+*/
+extern void Linereader_free(T *reader)
+{
+    assert(reader != NULL && *reader != NULL);
+    stopPrefetch(*reader);
+    if ((*reader)->mapped) {
+        munmap((*reader)->buffer, (*reader)->capacity);
+    } else {
+        free((*reader)->buffer);
+    }
+    free(*reader);
+    *reader = NULL;
+}
+
+/* Linereader_reset
+ *
+ *    Purpose: Point a streaming reader at a new input, keeping its buffer
+ *             (and whatever size it has grown to) for the new stream. A
+ *             background reader on the old stream is stopped.
+ * Parameters: The reader and the new input stream
+ *    Returns: None
+*/
+extern void Linereader_reset(T reader, FILE *fp)
+{
+    assert(reader != NULL && fp != NULL);
+    assert(!reader->mapped);
+    stopPrefetch(reader);
+    reader->fp = fp;
+    reader->start = 0;
+    reader->end = 0;
+    reader->released = 0;
+    reader->eof = false;
+}
+
+/* Linereader_next
+ *
+ *    Purpose: Find the next line of the input without copying it
+ * Parameters: The reader and references to the line pointer and length
+ *    Returns: True if a line was found, false once the input is exhausted.
+ *             The line points into the reader's buffer and is only valid
+ *             until the next call (or, for a mapped reader, until the
+ *             reader is freed). A final line without a '\n' is still
+ *             returned.
+*/
+extern bool Linereader_next(T reader, const char **linep, size_t *lenp)
+{
+    assert(reader != NULL);
+    assert(linep != NULL && lenp != NULL);
+    size_t scanned = reader->start;
+
+    for (;;) {
+        char *newline = memchr(reader->buffer + scanned, '\n',
+                               reader->end - scanned);
+        if (newline != NULL) {
+            *linep = reader->buffer + reader->start;
+            *lenp = newline - *linep;
+            reader->start = newline - reader->buffer + 1;
+            return true;
+        }
+
+        size_t seen = reader->end - reader->start;
+        if (!fill(reader)) {
+            break;
+        }
+        scanned = reader->start + seen;
+    }
+
+    if (reader->start == reader->end) {
+        *linep = NULL;
+        *lenp = 0;
+        return false;
+    }
+
+    *linep = reader->buffer + reader->start;
+    *lenp = reader->end - reader->start;
+    reader->start = reader->end;
+    return true;
+}
+
+/* Linereader_prefetch
+ *
+ *    Purpose: Start a thread that reads ahead of the parser, so that the
+ *             input is being read while the lines before it are worked on.
+ *             It must be called before the first line is asked for.
+ * Parameters: The reader and how many blocks (of a megabyte) the thread
+ *             may get ahead
+ *    Returns: None
+*/
+extern void Linereader_prefetch(T reader, int depth)
+{
+    assert(reader != NULL && depth > 0);
+    assert(reader->prefetch == NULL && reader->start == 0);
+
+    struct Prefetch *prefetch = malloc(sizeof(*prefetch));
+    assert(prefetch != NULL);
+    pthread_mutex_init(&prefetch->lock, NULL);
+    pthread_cond_init(&prefetch->filled, NULL);
+    pthread_cond_init(&prefetch->drained, NULL);
+    prefetch->depth = depth;
+    prefetch->blocks = NULL;
+    prefetch->lengths = NULL;
+    prefetch->head = 0;
+    prefetch->count = 0;
+    prefetch->ready = 0;
+    prefetch->taken = 0;
+    prefetch->done = false;
+    prefetch->stop = false;
+    prefetch->parserWait = 0;
+    prefetch->readerWait = 0;
+
+    if (reader->mapped) {
+        /* Only what the thread has touched is shown to the parser */
+        reader->end = 0;
+        reader->eof = false;
+    } else {
+        prefetch->blocks = malloc(depth * sizeof(char *));
+        prefetch->lengths = malloc(depth * sizeof(size_t));
+        assert(prefetch->blocks != NULL && prefetch->lengths != NULL);
+        for (int i = 0; i < depth; i++) {
+            prefetch->blocks[i] = malloc(PREFETCH_BLOCK);
+            assert(prefetch->blocks[i] != NULL);
+        }
+    }
+
+    reader->prefetch = prefetch;
+    int failed = pthread_create(&prefetch->thread, NULL,
+                                reader->mapped ? touchAhead : readAhead,
+                                reader);
+    assert(failed == 0);
+}
+
+/* Linereader_waits
+ *
+ *    Purpose: Tell how long the parser and the background reader spent
+ *             waiting for each other
+ * Parameters: The reader and references to the parser's waiting time (for
+ *             input that was not read yet) and the background reader's
+ *             (for room ahead of the parser), in seconds
+ *    Returns: None. Both are 0 if the reader has no background reader.
+*/
+extern void Linereader_waits(T reader, double *parserWait,
+                             double *readerWait)
+{
+    assert(reader != NULL && parserWait != NULL && readerWait != NULL);
+    struct Prefetch *prefetch = reader->prefetch;
+    if (prefetch == NULL) {
+        *parserWait = 0;
+        *readerWait = 0;
+        return;
+    }
+
+    pthread_mutex_lock(&prefetch->lock);
+    *parserWait = prefetch->parserWait;
+    *readerWait = prefetch->readerWait;
+    pthread_mutex_unlock(&prefetch->lock);
+}
+
+/* Linereader_release
+ *
+ *    Purpose: Let the kernel take back the pages of a mapped file that
+ *             have already been read, so that they stop counting against
+ *             the process's memory. Lines handed out earlier stay valid:
+ *             their pages are read in again if they are used. This is
+ *             done a few megabytes at a time, so it is cheap to call for
+ *             every line. Streaming readers have nothing to release.
+ * Parameters: The reader
+ *    Returns: None
+*/
+extern void Linereader_release(T reader)
+{
+    assert(reader != NULL);
+    if (!reader->mapped || reader->start - reader->released < RELEASE_STEP) {
+        return;
+    }
+
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t upto = reader->start / page * page;
+    madvise(reader->buffer + reader->released, upto - reader->released,
+            MADV_DONTNEED);
+    reader->released = upto;
+}
+
+/* Linereader_size
+ *
+ *    Purpose: Report how big the input is, for sizing tables up front
+ * Parameters: The reader
+ *    Returns: The size of the input in bytes, or 0 if it cannot be known
+ *             (pipes and terminals)
+*/
+extern size_t Linereader_size(T reader)
+{
+    assert(reader != NULL);
+    if (reader->mapped) {
+        return reader->capacity;
+    }
+
+    struct stat info;
+    if (fstat(fileno(reader->fp), &info) != 0 || !S_ISREG(info.st_mode)) {
+        return 0;
+    }
+    return info.st_size;
+}
+
+/* Linereader_data
+ *
+ *    Purpose: Get at the whole input of a mapped reader at once, for
+ *             callers that want to cut it up themselves
+ * Parameters: The reader and a reference to the size
+ *    Returns: The start of the mapping, or NULL if the reader is streaming
+*/
+extern const char *Linereader_data(T reader, size_t *sizep)
+{
+    assert(reader != NULL && sizep != NULL);
+    if (!reader->mapped) {
+        *sizep = 0;
+        return NULL;
+    }
+    *sizep = reader->capacity;
+    return reader->buffer;
+}
+
+/* Linereader_read
+ *
+ *    Purpose: Copy the next line into a buffer owned by the caller. The
+ *             buffer is grown with realloc when the line does not fit, so
+ *             passing the same buffer back in means it is only ever
+ *             allocated a handful of times.
+ * Parameters: The reader, a reference to the buffer and its capacity (may
+ *             start out as NULL and 0), and a reference to the line length
+ *    Returns: True if a line was read. The copy is '\0' terminated.
+*/
+extern bool Linereader_read(T reader, char **bufp, size_t *capp,
+                            size_t *lenp)
+{
+    assert(bufp != NULL && capp != NULL);
+    const char *line;
+    size_t len;
+
+    if (!Linereader_next(reader, &line, &len)) {
+        *lenp = 0;
+        return false;
+    }
+
+    if (*bufp == NULL || *capp < len + 1) {
+        size_t capacity = *capp > 0 ? *capp : 128;
+        while (capacity < len + 1) {
+            capacity = capacity * 2;
+        }
+        *bufp = (char*) realloc(*bufp, capacity * sizeof(char));
+        assert(*bufp != NULL);
+        *capp = capacity;
+    }
+
+    memcpy(*bufp, line, len);
+    (*bufp)[len] = '\0';
+    *lenp = len;
+    return true;
+}
+
+/* fill
+ *
+ *    Purpose: Slide the unread part of the buffer to the front and read
+ *             more input after it, doubling the buffer if it is full.
+ * Parameters: The reader
+ *    Returns: False if no more bytes could be read
+*/
+static bool fill(T reader)
+{
+    if (reader->eof) {
+        return false;
+    }
+    if (reader->prefetch != NULL) {
+        return fillPrefetched(reader);
+    }
+
+    size_t pending = reader->end - reader->start;
+    if (reader->start > 0) {
+        memmove(reader->buffer, reader->buffer + reader->start, pending);
+        reader->start = 0;
+        reader->end = pending;
+    }
+
+    if (reader->end == reader->capacity) {
+        reader->capacity = reader->capacity * 2;
+        reader->buffer = (char*) realloc(reader->buffer,
+                                         reader->capacity * sizeof(char));
+        assert(reader->buffer != NULL);
+    }
+
+    size_t got = fread(reader->buffer + reader->end, 1,
+                       reader->capacity - reader->end, reader->fp);
+    reader->end += got;
+    if (got == 0) {
+        reader->eof = true;
+        return false;
+    }
+    return true;
+}
+
+/* fillPrefetched
+ *
+ *    Purpose: Wait for the background reader's next blocks. A mapped
+ *             reader is shown every page that has been touched; a
+ *             streaming reader copies the next block out of the ring,
+ *             after sliding the unread bytes to the front.
+ * Parameters: The reader
+ *    Returns: False once the input is exhausted
+*/
+static bool fillPrefetched(T reader)
+{
+    struct Prefetch *prefetch = reader->prefetch;
+    pthread_mutex_lock(&prefetch->lock);
+
+    if (reader->mapped) {
+        while (prefetch->ready == reader->end && !prefetch->done) {
+            prefetch->parserWait += waitFor(&prefetch->filled,
+                                            &prefetch->lock);
+        }
+        bool more = prefetch->ready > reader->end;
+        reader->end = prefetch->ready;
+        reader->eof = reader->end == reader->capacity;
+        prefetch->taken = reader->end;
+        pthread_cond_signal(&prefetch->drained);
+        pthread_mutex_unlock(&prefetch->lock);
+        return more;
+    }
+
+    while (prefetch->count == 0 && !prefetch->done) {
+        prefetch->parserWait += waitFor(&prefetch->filled, &prefetch->lock);
+    }
+    if (prefetch->count == 0) {
+        reader->eof = true;
+        pthread_mutex_unlock(&prefetch->lock);
+        return false;
+    }
+    const char *block = prefetch->blocks[prefetch->head];
+    size_t length = prefetch->lengths[prefetch->head];
+    pthread_mutex_unlock(&prefetch->lock);
+
+    size_t pending = reader->end - reader->start;
+    memmove(reader->buffer, reader->buffer + reader->start, pending);
+    reader->start = 0;
+    reader->end = pending;
+    if (reader->capacity < pending + length) {
+        while (reader->capacity < pending + length) {
+            reader->capacity = reader->capacity * 2;
+        }
+        reader->buffer = (char*) realloc(reader->buffer,
+                                         reader->capacity * sizeof(char));
+        assert(reader->buffer != NULL);
+    }
+    memcpy(reader->buffer + reader->end, block, length);
+    reader->end += length;
+
+    pthread_mutex_lock(&prefetch->lock);
+    prefetch->head = (prefetch->head + 1) % prefetch->depth;
+    prefetch->count--;
+    pthread_cond_signal(&prefetch->drained);
+    pthread_mutex_unlock(&prefetch->lock);
+    return true;
+}
+
+/* readAhead
+ *
+ *    Purpose: The background reader of a stream: fill free blocks of the
+ *             ring with fread until the stream runs out
+ * Parameters: The reader
+ *    Returns: NULL
+*/
+static void *readAhead(void *closure)
+{
+    T reader = closure;
+    struct Prefetch *prefetch = reader->prefetch;
+
+    for (;;) {
+        pthread_mutex_lock(&prefetch->lock);
+        while (prefetch->count == prefetch->depth && !prefetch->stop) {
+            prefetch->readerWait += waitFor(&prefetch->drained,
+                                            &prefetch->lock);
+        }
+        if (prefetch->stop) {
+            pthread_mutex_unlock(&prefetch->lock);
+            return NULL;
+        }
+        int slot = (prefetch->head + prefetch->count) % prefetch->depth;
+        pthread_mutex_unlock(&prefetch->lock);
+
+        size_t got = fread(prefetch->blocks[slot], 1, PREFETCH_BLOCK,
+                           reader->fp);
+
+        pthread_mutex_lock(&prefetch->lock);
+        if (got > 0) {
+            prefetch->lengths[slot] = got;
+            prefetch->count++;
+        }
+        prefetch->done = got < PREFETCH_BLOCK;
+        pthread_cond_signal(&prefetch->filled);
+        pthread_mutex_unlock(&prefetch->lock);
+        if (got < PREFETCH_BLOCK) {
+            return NULL;
+        }
+    }
+}
+
+/* touchAhead
+ *
+ *    Purpose: The background reader of a mapping: read one byte of every
+ *             page of each block so that the kernel brings it in, staying
+ *             no more than depth blocks past what the parser has taken
+ * Parameters: The reader
+ *    Returns: NULL
+*/
+static void *touchAhead(void *closure)
+{
+    T reader = closure;
+    struct Prefetch *prefetch = reader->prefetch;
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t ahead = (size_t)prefetch->depth * PREFETCH_BLOCK;
+    const volatile char *data = reader->buffer;
+    char sink = 0;
+
+    for (size_t at = 0; at < reader->capacity; at += PREFETCH_BLOCK) {
+        pthread_mutex_lock(&prefetch->lock);
+        while (at >= prefetch->taken + ahead && !prefetch->stop) {
+            prefetch->readerWait += waitFor(&prefetch->drained,
+                                            &prefetch->lock);
+        }
+        bool stop = prefetch->stop;
+        pthread_mutex_unlock(&prefetch->lock);
+        if (stop) {
+            return NULL;
+        }
+
+        size_t upto = at + PREFETCH_BLOCK < reader->capacity ?
+                      at + PREFETCH_BLOCK : reader->capacity;
+        for (size_t i = at; i < upto; i += page) {
+            sink ^= data[i];
+        }
+
+        pthread_mutex_lock(&prefetch->lock);
+        prefetch->ready = upto;
+        pthread_cond_signal(&prefetch->filled);
+        pthread_mutex_unlock(&prefetch->lock);
+    }
+
+    pthread_mutex_lock(&prefetch->lock);
+    prefetch->done = true;
+    pthread_cond_signal(&prefetch->filled);
+    pthread_mutex_unlock(&prefetch->lock);
+    (void)sink;
+    return NULL;
+}
+
+/* stopPrefetch
+ *
+ *    Purpose: Stop the background reader, if there is one, and free it.
+ *             A mapped reader is shown the whole mapping again.
+ * Parameters: The reader
+ *    Returns: None
+*/
+static void stopPrefetch(T reader)
+{
+    struct Prefetch *prefetch = reader->prefetch;
+    if (prefetch == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&prefetch->lock);
+    prefetch->stop = true;
+    pthread_cond_signal(&prefetch->drained);
+    pthread_mutex_unlock(&prefetch->lock);
+    pthread_join(prefetch->thread, NULL);
+
+    if (prefetch->blocks != NULL) {
+        for (int i = 0; i < prefetch->depth; i++) {
+            free(prefetch->blocks[i]);
+        }
+        free(prefetch->blocks);
+        free(prefetch->lengths);
+    }
+    pthread_mutex_destroy(&prefetch->lock);
+    pthread_cond_destroy(&prefetch->filled);
+    pthread_cond_destroy(&prefetch->drained);
+    free(prefetch);
+    reader->prefetch = NULL;
+    if (reader->mapped) {
+        reader->end = reader->capacity;
+        reader->eof = true;
+    }
+}
+
+/* waitFor
+ *
+ *    Purpose: Wait on a condition and time the wait
+ * Parameters: The condition and the lock, which is held
+ *    Returns: How long the wait took, in seconds
+*/
+static double waitFor(pthread_cond_t *cond, pthread_mutex_t *lock)
+{
+    struct timespec before, after;
+    clock_gettime(CLOCK_MONOTONIC, &before);
+    pthread_cond_wait(cond, lock);
+    clock_gettime(CLOCK_MONOTONIC, &after);
+    return (after.tv_sec - before.tv_sec) +
+           (after.tv_nsec - before.tv_nsec) / 1e9;
+}
+
+#undef T
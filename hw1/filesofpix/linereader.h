@@ -0,0 +1,48 @@
+/* 
+ *   linereader.h
+ *   by: Drew Maynard and Joel Brandinger, 01/27/21
+ *   Files, Pictures and Interfaces
+ *
+ *   This file contains the interface for the line reader. Unlike readaline,
+ *   a Linereader_T fills one large buffer with fread and finds the end of
+ *   each line with memchr, so no memory is allocated per line. Lines are
+ *   handed back either as a view into the internal buffer or copied into a
+ *   buffer owned (and reused) by the caller. The '\n' is never included.
+ *
+ *   A reader made with Linereader_map walks a memory-mapped file instead,
+ *   and the views it returns stay valid until the reader is freed.
+ *   Linereader_release hands the pages already read back to the kernel;
+ *   they are read from the file again if they are looked at later.
+ *
+ *   Linereader_prefetch gives either kind of reader a thread that reads up
+ *   to a given number of blocks ahead, so that slow storage is read while
+ *   the lines before are being worked on; Linereader_waits tells how long
+ *   the parser waited for input and the thread waited for the parser.
+*/
+
+#ifndef LINEREADER_INCLUDED
+#define LINEREADER_INCLUDED
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#define T Linereader_T
+typedef struct T *T;
+
+extern T Linereader_new(FILE *fp, size_t bufsize);
+extern T Linereader_map(const char *filename);
+extern void Linereader_free(T *reader);
+extern void Linereader_reset(T reader, FILE *fp);
+
+extern bool Linereader_next(T reader, const char **linep, size_t *lenp);
+extern void Linereader_prefetch(T reader, int depth);
+extern void Linereader_waits(T reader, double *parserWait,
+                             double *readerWait);
+extern void Linereader_release(T reader);
+extern size_t Linereader_size(T reader);
+extern const char *Linereader_data(T reader, size_t *sizep);
+extern bool Linereader_read(T reader, char **bufp, size_t *capp,
+                            size_t *lenp);
+
+#undef T
+#endif
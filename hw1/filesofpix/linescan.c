@@ -0,0 +1,492 @@
+/* 
+ *   linescan.c
+ *   by: Drew Maynard and Joel Brandinger, 01/27/21
+ *   Files, Pictures and Interfaces
+ *
+ *   This file contains the implementation of the vectorized line scanners.
+ *   Lines are handled 64 bytes at a time:
+ *
+ *     1. the block is classified with SIMD compares into a 64-bit mask
+ *        with one bit per digit;
+ *     2. the non-digit bytes are packed into the pattern 8 bytes at a
+ *        time (with a pshufb lookup table when AVX2 is there, otherwise
+ *        whole 8-byte groups of non-digits are copied at once);
+ *     3. runs of digits are found with count-trailing-zeros on the mask
+ *        and each run is parsed directly, without testing its bytes again.
+ *
+ *   A number that runs off the end of a block is carried into the next
+ *   one. The last partial block is copied into a padded buffer so that no
+ *   load ever reads past the end of the line (which may be the end of a
+ *   memory mapping).
+ *
+ *   The fingerprinters do steps 1 and 2 only, packing into a small staging
+ *   buffer instead of the pattern, and feed each full 8 bytes of it to
+ *   Fptable_step while it is still in a register's reach.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "linescan.h"
+#include "fptable.h"
+
+#if defined(__GNUC__) && defined(__SSE2__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define LINESCAN_X86 1
+#include <immintrin.h>
+#include <pthread.h>
+#endif
+
+#ifdef LINESCAN_X86
+
+#define BLOCK 64
+#define PAD ' '
+
+typedef uint64_t (*Classify)(const char *block);
+typedef int (*Compress)(const char *block, uint64_t keep, char *out);
+
+/* The state of a number that may continue into the next block */
+struct Carry {
+    unsigned value;
+    bool inNumber;
+};
+
+static uint8_t shuffles[256][8];
+static int keepCounts[256];
+static pthread_once_t shufflesOnce = PTHREAD_ONCE_INIT;
+
+static int scanBlocks(int bytes, const char *datapp, uint8_t *pixels,
+                      int *width, char *characters, Classify classify,
+                      Compress compress);
+static int splitBlock(const char *block, int n, uint64_t digits,
+                      bool last, struct Carry *carry, uint8_t *pixels,
+                      int *width);
+static unsigned parseRun(const char *digits, int length, unsigned value);
+static void buildShuffles(void);
+static uint64_t classifySse2(const char *block);
+static int compressScalar(const char *block, uint64_t keep, char *out);
+static int scanSse2(int bytes, const char *datapp, uint8_t *pixels,
+                    int *width, char *characters);
+static uint64_t classifyAvx2(const char *block)
+    __attribute__((target("avx2")));
+static int compressAvx2(const char *block, uint64_t keep, char *out)
+    __attribute__((target("avx2")));
+static int scanAvx2(int bytes, const char *datapp, uint8_t *pixels,
+                    int *width, char *characters);
+static uint64_t hashBlocks(const char *line, size_t bytes, size_t *length,
+                           Classify classify, Compress compress);
+static uint64_t hashSse2(const char *line, size_t bytes, size_t *length);
+static uint64_t hashAvx2(const char *line, size_t bytes, size_t *length);
+
+#endif
+
+/* Linescan_select
+ *
+ *    Purpose: Pick the fastest scanner this machine can run
+ * Parameters: The name of a scanner to force ("avx2", "sse2" or
+ *             "scalar"), or NULL to choose automatically
+ *    Returns: The scanner, or NULL if the scalar processLine should be
+ *             used (because it was asked for or nothing else is available)
+*/
+extern Linescan_T Linescan_select(const char *name)
+{
+#ifdef LINESCAN_X86
+    pthread_once(&shufflesOnce, buildShuffles);
+    bool avx2 = __builtin_cpu_supports("avx2");
+
+    if (name == NULL) {
+        return avx2 ? scanAvx2 : scanSse2;
+    }
+    if (strcmp(name, "avx2") == 0 && avx2) {
+        return scanAvx2;
+    }
+    if (strcmp(name, "sse2") == 0) {
+        return scanSse2;
+    }
+#else
+    (void)name;
+#endif
+    return NULL;
+}
+
+/* Linescan_hasher
+ *
+ *    Purpose: Get the fused fingerprinter that goes with a scanner
+ * Parameters: The scanner (NULL meaning processLine)
+ *    Returns: The fingerprinter; Fptable_linehash for processLine
+*/
+extern Linehash_T Linescan_hasher(Linescan_T scanner)
+{
+#ifdef LINESCAN_X86
+    if (scanner == scanAvx2) {
+        return hashAvx2;
+    }
+    if (scanner == scanSse2) {
+        return hashSse2;
+    }
+#endif
+    (void)scanner;
+    return Fptable_linehash;
+}
+
+/* Linescan_name
+ *
+ *    Purpose: Name a scanner, for reporting
+ * Parameters: The scanner (NULL meaning processLine)
+ *    Returns: "avx2", "sse2" or "scalar"
+*/
+extern const char *Linescan_name(Linescan_T scanner)
+{
+#ifdef LINESCAN_X86
+    if (scanner == scanAvx2) {
+        return "avx2";
+    }
+    if (scanner == scanSse2) {
+        return "sse2";
+    }
+#endif
+    (void)scanner;
+    return "scalar";
+}
+
+#ifdef LINESCAN_X86
+
+/* scanBlocks
+ *
+ *    Purpose: Split a line into pixels and pattern, 64 bytes at a time
+ * Parameters: The same as processLine, plus the classify and compress
+ *             steps to use
+ *    Returns: The number of characters in the pattern
+*/
+static int scanBlocks(int bytes, const char *datapp, uint8_t *pixels,
+                      int *width, char *characters, Classify classify,
+                      Compress compress)
+{
+    struct Carry carry = { 0, false };
+    int a = 0;
+    int i = 0;
+    *width = 0;
+
+    for (; i + BLOCK <= bytes; i += BLOCK) {
+        uint64_t digits = classify(datapp + i);
+        a += compress(datapp + i, ~digits, characters + a);
+        splitBlock(datapp + i, BLOCK, digits, i + BLOCK == bytes, &carry,
+                   pixels, width);
+    }
+
+    if (i < bytes) {
+        char tail[BLOCK];
+        int n = bytes - i;
+        memcpy(tail, datapp + i, n);
+        memset(tail + n, PAD, BLOCK - n);
+
+        uint64_t valid = (UINT64_C(1) << n) - 1;
+        uint64_t digits = classify(tail) & valid;
+        a += compress(tail, ~digits & valid, characters + a);
+        splitBlock(tail, n, digits, true, &carry, pixels, width);
+    }
+
+    characters[a] = '\0';
+    return a;
+}
+
+/* hashBlocks
+ *
+ *    Purpose: Fingerprint the pattern of a line, 64 bytes at a time
+ * Parameters: The line, its length, a reference that is set to the length
+ *             of the pattern, and the classify and compress steps to use
+ *    Returns: The fingerprint of the pattern
+*/
+static uint64_t hashBlocks(const char *line, size_t bytes, size_t *length,
+                           Classify classify, Compress compress)
+{
+    /* Up to 7 bytes left over, a block, and the compress step's slack */
+    char stage[8 + BLOCK + LINESCAN_SLACK];
+    uint64_t hash = FPTABLE_SEED;
+    size_t n = 0;
+    int pending = 0;
+    size_t i = 0;
+
+    for (;; i += BLOCK) {
+        const char *block = line + i;
+        uint64_t keep = ~UINT64_C(0);
+        char tail[BLOCK];
+        if (i + BLOCK > bytes) {
+            if (i == bytes) {
+                break;
+            }
+            int rest = bytes - i;
+            memcpy(tail, line + i, rest);
+            memset(tail + rest, PAD, BLOCK - rest);
+            block = tail;
+            keep = (UINT64_C(1) << rest) - 1;
+        }
+
+        int kept = compress(block, ~classify(block) & keep, stage + pending);
+        pending += kept;
+        n += kept;
+
+        int w = 0;
+        for (; w + 8 <= pending; w += 8) {
+            uint64_t word;
+            memcpy(&word, stage + w, 8);
+            hash = Fptable_step(hash, word);
+        }
+        memmove(stage, stage + w, pending - w);
+        pending -= w;
+
+        if (block == tail) {
+            break;
+        }
+    }
+
+    uint64_t word = 0;
+    memcpy(&word, stage, pending);
+    *length = n;
+    return Fptable_finish(hash, word, n);
+}
+
+/* splitBlock
+ *
+ *    Purpose: Turn the digit runs of one block into pixel values
+ * Parameters: The block, how many of its bytes belong to the line, its
+ *             digit mask, whether it is the last block of the line, the
+ *             number carried in from the previous block, and where the
+ *             pixels go
+ *    Returns: The number of pixels added
+*/
+static int splitBlock(const char *block, int n, uint64_t digits,
+                      bool last, struct Carry *carry, uint8_t *pixels,
+                      int *width)
+{
+    int start = *width;
+    int s = 0;
+
+    if (carry->inNumber) {
+        uint64_t notDigits = ~digits;
+        int length = notDigits == 0 ? BLOCK : __builtin_ctzll(notDigits);
+        if (length > n) {
+            length = n;
+        }
+        carry->value = parseRun(block, length, carry->value);
+        if (length == n && !last) {
+            return 0;
+        }
+        pixels[(*width)++] = (uint8_t)carry->value;
+        carry->inNumber = false;
+        s = length;
+        digits = length == BLOCK ? 0 : digits & ~((UINT64_C(1) << s) - 1);
+    }
+
+    while (digits != 0) {
+        s = __builtin_ctzll(digits);
+        uint64_t rest = ~(digits >> s);
+        int length = rest == 0 ? BLOCK - s : __builtin_ctzll(rest);
+        unsigned value = parseRun(block + s, length, 0);
+
+        if (s + length == n && !last) {
+            carry->value = value;
+            carry->inNumber = true;
+            break;
+        }
+        pixels[(*width)++] = (uint8_t)value;
+        digits = s + length == BLOCK ? 0
+               : digits & ~((UINT64_C(1) << (s + length)) - 1);
+    }
+
+    return *width - start;
+}
+
+/* parseRun
+ *
+ *    Purpose: Parse a run of digits already known to be digits. Runs of
+ *             one to three digits (every real pixel) are done without a
+ *             loop.
+ * Parameters: The digits, how many there are, and the value so far
+ *    Returns: The value
+*/
+static unsigned parseRun(const char *digits, int length, unsigned value)
+{
+    const unsigned char *d = (const unsigned char *)digits;
+    switch (length) {
+    case 0:
+        return value;
+    case 1:
+        return value * 10 + (d[0] - '0');
+    case 2:
+        return value * 100 + (d[0] - '0') * 10 + (d[1] - '0');
+    case 3:
+        return value * 1000 + (d[0] - '0') * 100 + (d[1] - '0') * 10 +
+               (d[2] - '0');
+    default:
+        for (int i = 0; i < length; i++) {
+            value = value * 10 + (d[i] - '0');
+        }
+        return value;
+    }
+}
+
+/* buildShuffles
+ *
+ *    Purpose: Fill in the lookup table used to pack the kept bytes of an
+ *             8-byte group to the front: for each 8-bit keep mask, the
+ *             indices of its set bits in order. Run once, through
+ *             pthread_once, by the first Linescan_select of any thread
+ * Parameters: None
+ *    Returns: None
+*/
+static void buildShuffles(void)
+{
+    for (int mask = 0; mask < 256; mask++) {
+        int n = 0;
+        for (int bit = 0; bit < 8; bit++) {
+            if (mask & (1 << bit)) {
+                shuffles[mask][n++] = bit;
+            }
+        }
+        for (int j = n; j < 8; j++) {
+            shuffles[mask][j] = 0x80;
+        }
+        keepCounts[mask] = n;
+    }
+}
+
+/* classifySse2
+ *
+ *    Purpose: Find the digits of a 64-byte block with SSE2
+ * Parameters: The block
+ *    Returns: A mask with bit i set if byte i is a digit
+*/
+static uint64_t classifySse2(const char *block)
+{
+    const __m128i low = _mm_set1_epi8('0' - 1);
+    const __m128i high = _mm_set1_epi8('9' + 1);
+    uint64_t mask = 0;
+
+    for (int i = 0; i < BLOCK; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(block + i));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, low),
+                                      _mm_cmplt_epi8(v, high));
+        mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(digit) << i;
+    }
+    return mask;
+}
+
+/* compressScalar
+ *
+ *    Purpose: Pack the kept bytes of a block without a byte shuffle.
+ *             Groups of 8 that are all kept (most of a junk line) are
+ *             copied in one go.
+ * Parameters: The block, the mask of bytes to keep, and where they go
+ *    Returns: The number of bytes kept
+*/
+static int compressScalar(const char *block, uint64_t keep, char *out)
+{
+    int n = 0;
+    for (int group = 0; group < BLOCK; group += 8) {
+        unsigned bits = (keep >> group) & 0xff;
+        if (bits == 0xff) {
+            memcpy(out + n, block + group, 8);
+            n += 8;
+            continue;
+        }
+        while (bits != 0) {
+            out[n++] = block[group + __builtin_ctz(bits)];
+            bits &= bits - 1;
+        }
+    }
+    return n;
+}
+
+/* scanSse2
+ *
+ *    Purpose: The SSE2 scanner
+ * Parameters: The same as processLine
+ *    Returns: The number of characters in the pattern
+*/
+static int scanSse2(int bytes, const char *datapp, uint8_t *pixels,
+                    int *width, char *characters)
+{
+    return scanBlocks(bytes, datapp, pixels, width, characters,
+                      classifySse2, compressScalar);
+}
+
+/* hashSse2
+ *
+ *    Purpose: The SSE2 fingerprinter
+ * Parameters: The same as Fptable_linehash
+ *    Returns: The fingerprint of the pattern
+*/
+static uint64_t hashSse2(const char *line, size_t bytes, size_t *length)
+{
+    return hashBlocks(line, bytes, length, classifySse2, compressScalar);
+}
+
+/* classifyAvx2
+ *
+ *    Purpose: Find the digits of a 64-byte block with AVX2
+ * Parameters: The block
+ *    Returns: A mask with bit i set if byte i is a digit
+*/
+static uint64_t classifyAvx2(const char *block)
+{
+    const __m256i low = _mm256_set1_epi8('0' - 1);
+    const __m256i high = _mm256_set1_epi8('9' + 1);
+
+    __m256i v0 = _mm256_loadu_si256((const __m256i *)block);
+    __m256i v1 = _mm256_loadu_si256((const __m256i *)(block + 32));
+    __m256i d0 = _mm256_and_si256(_mm256_cmpgt_epi8(v0, low),
+                                  _mm256_cmpgt_epi8(high, v0));
+    __m256i d1 = _mm256_and_si256(_mm256_cmpgt_epi8(v1, low),
+                                  _mm256_cmpgt_epi8(high, v1));
+
+    return (uint64_t)(uint32_t)_mm256_movemask_epi8(d0) |
+           (uint64_t)(uint32_t)_mm256_movemask_epi8(d1) << 32;
+}
+
+/* compressAvx2
+ *
+ *    Purpose: Pack the kept bytes of a block with one pshufb per group of
+ *             8. Each store writes a full 8 bytes, which is why the
+ *             pattern buffer needs LINESCAN_SLACK spare bytes.
+ * Parameters: The block, the mask of bytes to keep, and where they go
+ *    Returns: The number of bytes kept
+*/
+static int compressAvx2(const char *block, uint64_t keep, char *out)
+{
+    int n = 0;
+    for (int group = 0; group < BLOCK; group += 8) {
+        unsigned bits = (keep >> group) & 0xff;
+        __m128i v = _mm_loadl_epi64((const __m128i *)(block + group));
+        __m128i order = _mm_loadl_epi64((const __m128i *)shuffles[bits]);
+        _mm_storel_epi64((__m128i *)(out + n), _mm_shuffle_epi8(v, order));
+        n += keepCounts[bits];
+    }
+    return n;
+}
+
+/* scanAvx2
+ *
+ *    Purpose: The AVX2 scanner
+ * Parameters: The same as processLine
+ *    Returns: The number of characters in the pattern
+*/
+static int scanAvx2(int bytes, const char *datapp, uint8_t *pixels,
+                    int *width, char *characters)
+{
+    return scanBlocks(bytes, datapp, pixels, width, characters,
+                      classifyAvx2, compressAvx2);
+}
+
+/* hashAvx2
+ *
+ *    Purpose: The AVX2 fingerprinter
+ * Parameters: The same as Fptable_linehash
+ *    Returns: The fingerprint of the pattern
+*/
+static uint64_t hashAvx2(const char *line, size_t bytes, size_t *length)
+{
+    return hashBlocks(line, bytes, length, classifyAvx2, compressAvx2);
+}
+
+#endif
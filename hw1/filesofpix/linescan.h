@@ -0,0 +1,39 @@
+/* 
+ *   linescan.h
+ *   by: Drew Maynard and Joel Brandinger, 01/27/21
+ *   Files, Pictures and Interfaces
+ *
+ *   This file contains the interface for the vectorized line scanners.
+ *   A scanner does the same job as processLine in uncorrupt.c: it splits
+ *   a line into its pixel values and its non-digit pattern. The SSE2
+ *   scanner is used on any x86-64 machine and the AVX2 scanner when the
+ *   processor supports it; elsewhere Linescan_select gives back NULL and
+ *   the caller keeps using processLine.
+ *
+ *   Each scanner has a fused fingerprinter to go with it, which makes one
+ *   pass over a line and gives back the fingerprint and length of its
+ *   pattern (as Fptable_linehash would) without storing the pattern or
+ *   parsing a single pixel.
+*/
+
+#ifndef LINESCAN_INCLUDED
+#define LINESCAN_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Buffers handed to a scanner need this many spare bytes past the line,
+ * because the pattern is stored 8 bytes at a time. */
+#define LINESCAN_SLACK 8
+
+typedef int (*Linescan_T)(int bytes, const char *datapp, uint8_t *pixels,
+                          int *width, char *characters);
+
+typedef uint64_t (*Linehash_T)(const char *line, size_t bytes,
+                               size_t *length);
+
+extern Linescan_T Linescan_select(const char *name);
+extern Linehash_T Linescan_hasher(Linescan_T scanner);
+extern const char *Linescan_name(Linescan_T scanner);
+
+#endif
@@ -0,0 +1,212 @@
+/* 
+ *   p5writer.c
+ *   by: Drew Maynard and Joel Brandinger, 01/27/21
+ *   Files, Pictures and Interfaces
+ *
+ *   This file contains the implementation of the P5 writer. When the
+ *   height is not known up front there are two ways to finish the header:
+ *
+ *     - a seekable output gets a header whose height field is padded with
+ *       spaces to a fixed width; closing seeks back and fills it in.
+ *     - anything else (a pipe, a terminal, or a file opened to append to,
+ *       where every write goes to the end) gets its rows spooled to an
+ *       unlinked temporary file, which is copied out after the header.
+ *
+ *   Either way the rows themselves are never kept in memory.
+ *
+ *   Rows are gathered into one large buffer that goes out in a single
+ *   fwrite whenever it fills up, so the cost of writing an image is a
+ *   handful of calls per megabyte rather than one per pixel. A row bigger
+ *   than the whole buffer is written on its own.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include "p5writer.h"
+
+#define T P5writer_T
+#define MAXVAL 255
+#define HEIGHT_DIGITS 10
+#define COPY_BUFSIZE (1 << 16)
+#define BUFSIZE (1 << 20)
+
+struct T {
+    FILE *output;
+    FILE *spool;
+    int width;
+    int height;
+    int rows;
+    long heightOffset;
+    uint8_t *buffer;
+    size_t used;
+    size_t capacity;
+};
+
+static bool seekable(FILE *fp);
+static void flush(T writer);
+static void copySpool(FILE *spool, FILE *output);
+
+/* P5writer_new
+ *
+ *    Purpose: Start writing a P5 image
+ * Parameters: The output stream, the width, and the height (-1 if it will
+ *             only be known once every row has been written)
+ *    Returns: A pointer to the new writer
+*/
+extern T P5writer_new(FILE *output, int width, int height)
+{
+    assert(output != NULL);
+    assert(width >= 0);
+    T writer = (void*)malloc(sizeof(struct T));
+    assert(writer != NULL);
+
+    writer->output = output;
+    writer->spool = NULL;
+    writer->width = width;
+    writer->height = height;
+    writer->rows = 0;
+    writer->heightOffset = -1;
+    writer->used = 0;
+    writer->capacity = BUFSIZE;
+    writer->buffer = malloc(writer->capacity);
+    assert(writer->buffer != NULL);
+
+    if (height >= 0) {
+        fprintf(output, "%s\n%d %d\n%d\n", "P5", width, height, MAXVAL);
+    } else if (seekable(output)) {
+        fprintf(output, "%s\n%d ", "P5", width);
+        writer->heightOffset = ftell(output);
+        fprintf(output, "%*s\n%d\n", HEIGHT_DIGITS, "", MAXVAL);
+    } else {
+        writer->spool = tmpfile();
+        assert(writer->spool != NULL);
+    }
+    return writer;
+}
+
+/* P5writer_row
+ *
+ *    Purpose: Write the next row of the image. Rows that are too short are
+ *             padded with black and rows that are too long are cut off,
+ *             so the raster always matches the header.
+ * Parameters: The writer, the pixel values and how many there are
+ *    Returns: None
+*/
+extern void P5writer_row(T writer, const uint8_t *pixels, int width)
+{
+    assert(writer != NULL);
+    size_t n = width < writer->width ? width : writer->width;
+    size_t size = writer->width;
+
+    if (writer->used + size > writer->capacity) {
+        flush(writer);
+    }
+
+    if (size > writer->capacity) {
+        FILE *fp = writer->spool != NULL ? writer->spool : writer->output;
+        fwrite(pixels, sizeof(uint8_t), n, fp);
+        for (size_t i = n; i < size; i++) {
+            putc(0, fp);
+        }
+    } else {
+        memcpy(writer->buffer + writer->used, pixels, n);
+        memset(writer->buffer + writer->used + n, 0, size - n);
+        writer->used += size;
+    }
+    writer->rows++;
+}
+
+/* P5writer_close
+ *
+ *    Purpose: Finish the image (filling in the height if it was unknown)
+ *             and deallocate the writer. The output is left open.
+ * Parameters: A reference to the writer
+ *    Returns: The number of rows written
+*/
+extern int P5writer_close(T *writer)
+{
+    assert(writer != NULL && *writer != NULL);
+    T w = *writer;
+    int rows = w->rows;
+    flush(w);
+
+    if (w->heightOffset >= 0) {
+        long end = ftell(w->output);
+        fseek(w->output, w->heightOffset, SEEK_SET);
+        fprintf(w->output, "%*d", HEIGHT_DIGITS, rows);
+        fseek(w->output, end, SEEK_SET);
+    } else if (w->spool != NULL) {
+        fprintf(w->output, "%s\n%d %d\n%d\n", "P5", w->width, rows, MAXVAL);
+        copySpool(w->spool, w->output);
+        fclose(w->spool);
+    } else {
+        assert(rows == w->height);
+    }
+
+    fflush(w->output);
+    free(w->buffer);
+    free(w);
+    *writer = NULL;
+    return rows;
+}
+
+/* seekable
+ *
+ *    Purpose: Check whether the header can be patched in place. A file
+ *             opened with O_APPEND (as by >>) can seek, but the patch
+ *             would be written at its end instead.
+ * Parameters: The output stream
+ *    Returns: True if the stream is a regular file with a position that
+ *             is not being appended to
+*/
+static bool seekable(FILE *fp)
+{
+    struct stat info;
+    if (fstat(fileno(fp), &info) != 0 || !S_ISREG(info.st_mode)) {
+        return false;
+    }
+    int flags = fcntl(fileno(fp), F_GETFL);
+    if (flags == -1 || (flags & O_APPEND)) {
+        return false;
+    }
+    return ftell(fp) >= 0;
+}
+
+/* flush
+ *
+ *    Purpose: Write out the rows gathered so far in one call
+ * Parameters: The writer
+ *    Returns: None
+*/
+static void flush(T writer)
+{
+    if (writer->used == 0) {
+        return;
+    }
+    FILE *fp = writer->spool != NULL ? writer->spool : writer->output;
+    fwrite(writer->buffer, sizeof(uint8_t), writer->used, fp);
+    writer->used = 0;
+}
+
+/* copySpool
+ *
+ *    Purpose: Copy the spooled rows to the real output
+ * Parameters: The spool file and the output
+ *    Returns: None
+*/
+static void copySpool(FILE *spool, FILE *output)
+{
+    char buffer[COPY_BUFSIZE];
+    size_t got;
+
+    rewind(spool);
+    while ((got = fread(buffer, 1, sizeof(buffer), spool)) > 0) {
+        fwrite(buffer, 1, got, output);
+    }
+}
+
+#undef T
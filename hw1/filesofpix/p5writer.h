@@ -0,0 +1,26 @@
+/* 
+ *   p5writer.h
+ *   by: Drew Maynard and Joel Brandinger, 01/27/21
+ *   Files, Pictures and Interfaces
+ *
+ *   This file contains the interface for the P5 writer, which writes a
+ *   raw graymap one row at a time. The height may be left unknown (-1)
+ *   when the writer is made: rows are then written out as they come and
+ *   the height is filled in when the writer is closed.
+*/
+
+#ifndef P5WRITER_INCLUDED
+#define P5WRITER_INCLUDED
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define T P5writer_T
+typedef struct T *T;
+
+extern T P5writer_new(FILE *output, int width, int height);
+extern void P5writer_row(T writer, const uint8_t *pixels, int width);
+extern int P5writer_close(T *writer);
+
+#undef T
+#endif
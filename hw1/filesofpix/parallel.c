@@ -0,0 +1,436 @@
+/* 
+ *   parallel.c
+ *   by: Drew Maynard and Joel Brandinger, 01/27/21
+ *   Files, Pictures and Interfaces
+ *
+ *   This file contains the implementation of multi-threaded restoration.
+ *
+ *     1. The mapped input is cut into one chunk per thread, each ending
+ *        just after a '\n'.
+ *     2. Every worker splits the lines of its chunk and groups them by
+ *        pattern in its own fingerprint table and arena. Each line is
+ *        remembered with its offset in the file, which is its place in
+ *        the serial order.
+ *     3. The main thread merges the groups of all the chunks (in chunk
+ *        order, so every merged group stays sorted) and picks the key:
+ *        the pattern whose second line comes first, i.e. the first
+ *        pattern the serial restoreLines would have seen twice.
+ *     4. The rows are emitted in the order restoreLines would list them:
+ *        every line that repeats an earlier pattern brings out the row
+ *        before it with that pattern, and the last row with the key goes
+ *        at the end.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include "parallel.h"
+#include "stats.h"
+
+/* One line of the input, kept with its place in the file. Its pixels are
+ * only there if it was decoded while scanning (because its fingerprint
+ * had been seen before); otherwise it is decoded if it is printed. */
+struct Occurrence {
+    struct Occurrence *next;
+    size_t offset;
+    int bytes;
+    int width;
+    uint8_t *pixels;
+};
+
+/* All the lines with one pattern, in file order. The pattern is the first
+ * of those lines, in place, until a second one is decoded; then it is a
+ * copy of the bare pattern. */
+struct Group {
+    uint64_t hash;
+    const char *pattern;
+    int bytes;
+    int length;
+    int count;
+    struct Occurrence *head;
+    struct Occurrence *tail;
+};
+
+/* The work and the results of one thread */
+struct Chunk {
+    pthread_t thread;
+    const char *data;
+    size_t begin;
+    size_t end;
+    Linescan_T scan;
+    Arena_T arena;
+    Fptable_T table;
+    struct Group **groups;
+    size_t numGroups;
+    size_t groupCapacity;
+    size_t numLines;
+};
+
+/* A row to print, and the offset of the line that brings it out */
+struct Emit {
+    size_t tag;
+    struct Occurrence *row;
+};
+
+static void splitChunks(const char *data, size_t size, struct Chunk *chunks,
+                        int threads);
+static void *scanChunk(void *cl);
+static void addGroup(struct Chunk *chunk, struct Group *group);
+static struct Group *mergeGroups(struct Chunk *chunks, int threads,
+                                 Arena_T arena, Fptable_T merged,
+                                 struct Chunk *all);
+static int emitRows(const char *data, struct Chunk *all, struct Group *key,
+                    Linescan_T scan, FILE *output);
+static int compareEmits(const void *x, const void *y);
+
+/* uncorruptParallel
+ *
+ *    Purpose: Restore a memory-mapped image using several threads
+ * Parameters: The mapped input, its size, the options for the run
+ *             (options->threads says how many threads to use), and where
+ *             the image goes
+ *    Returns: The number of rows written, or 0 if no original rows could
+ *             be found
+*/
+int uncorruptParallel(const char *data, size_t size,
+                      const struct RestoreOptions *options, FILE *output)
+{
+    assert(data != NULL && options != NULL);
+    int threads = options->threads > 0 ? options->threads : 1;
+    Linescan_T scan = Linescan_select(options->scanner);
+
+    struct Chunk *chunks = calloc(threads, sizeof(struct Chunk));
+    assert(chunks != NULL);
+    splitChunks(data, size, chunks, threads);
+
+    for (int i = 0; i < threads; i++) {
+        chunks[i].scan = scan;
+        int failed = pthread_create(&chunks[i].thread, NULL, scanChunk,
+                                    &chunks[i]);
+        assert(failed == 0);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(chunks[i].thread, NULL);
+    }
+
+    Arena_T arena = Arena_new(0);
+    struct Chunk all;
+    memset(&all, 0, sizeof(all));
+    Fptable_T merged = Fptable_new(arena, size / 256 + 16);
+    struct Group *key = mergeGroups(chunks, threads, arena, merged, &all);
+
+    if (Stats_enabled) {
+        for (int i = 0; i < threads; i++) {
+            Stats_count(COUNTER_LINES, chunks[i].numLines);
+        }
+        Stats_count(COUNTER_BYTES, size);
+        Stats_count(COUNTER_PATTERNS, Fptable_length(merged));
+        Stats_count(COUNTER_SLOTS, Fptable_capacity(merged));
+    }
+
+    STATS_ENTER(PHASE_EMIT);
+    int numRows = 0;
+    if (key != NULL) {
+        numRows = emitRows(data, &all, key, scan, output);
+    } else {
+        fprintf(stderr, "restoration: no original rows found\n");
+    }
+
+    free(all.groups);
+    for (int i = 0; i < threads; i++) {
+        free(chunks[i].groups);
+        Arena_free(&chunks[i].arena);
+    }
+    Arena_free(&arena);
+    free(chunks);
+    return numRows;
+}
+
+/* splitChunks
+ *
+ *    Purpose: Cut the input into roughly equal chunks that each end right
+ *             after a newline (or at the end of the input)
+ * Parameters: The input, its size, the chunks to fill in and how many
+ *    Returns: None
+*/
+static void splitChunks(const char *data, size_t size, struct Chunk *chunks,
+                        int threads)
+{
+    size_t begin = 0;
+    for (int i = 0; i < threads; i++) {
+        size_t end = size;
+        if (i < threads - 1) {
+            end = size / threads * (i + 1);
+            if (end < begin) {
+                end = begin;
+            }
+            if (end > begin) {
+                const char *newline = memchr(data + end - 1, '\n',
+                                             size - end + 1);
+                end = newline == NULL ? size
+                                      : (size_t)(newline - data) + 1;
+            }
+        }
+        chunks[i].data = data;
+        chunks[i].begin = begin;
+        chunks[i].end = end;
+        begin = end;
+    }
+}
+
+/* scanChunk
+ *
+ *    Purpose: Fingerprint every line of a chunk and group the lines by
+ *             pattern. Runs on its own thread and touches nothing but its
+ *             chunk.
+ * Parameters: The chunk
+ *    Returns: NULL
+*/
+static void *scanChunk(void *cl)
+{
+    struct Chunk *chunk = cl;
+    STATS_ENTER(PHASE_HASH);
+    chunk->arena = Arena_new(0);
+    chunk->table = Fptable_new(chunk->arena,
+                               (chunk->end - chunk->begin) / 256 + 16);
+
+    Linehash_T fingerprint = Linescan_hasher(chunk->scan);
+    size_t scratchSize = 0;
+    char *characters = NULL;
+    uint8_t *pixels = NULL;
+    size_t offset = chunk->begin;
+
+    while (offset < chunk->end) {
+        const char *line = chunk->data + offset;
+        const char *newline = memchr(line, '\n', chunk->end - offset);
+        int bytes = newline != NULL ? newline - line
+                                    : (int)(chunk->end - offset);
+        size_t length;
+        uint64_t hash = fingerprint(line, bytes, &length);
+        int width = 0;
+        int a = -1;
+        bool found;
+        void **slot;
+
+        if (!Fptable_has(chunk->table, hash, length)) {
+            slot = Fptable_hashslot(chunk->table, hash, line, bytes,
+                                    length, false, &found);
+        } else {
+            if ((size_t)bytes + 1 + LINESCAN_SLACK > scratchSize) {
+                scratchSize = 2 * (bytes + 1 + LINESCAN_SLACK);
+                characters = realloc(characters, scratchSize);
+                pixels = realloc(pixels, scratchSize);
+                assert(characters != NULL && pixels != NULL);
+            }
+            STATS_ENTER(PHASE_PARSE);
+            a = chunk->scan != NULL
+              ? chunk->scan(bytes, line, pixels, &width, characters)
+              : processLine(bytes, line, pixels, &width, characters);
+            STATS_ENTER(PHASE_HASH);
+            slot = Fptable_hashslot(chunk->table, hash, characters, a, a,
+                                    true, &found);
+        }
+
+        if (!found) {
+            struct Group *group = Arena_alloc(chunk->arena,
+                                              sizeof(struct Group));
+            group->hash = hash;
+            group->pattern = a < 0 ? line : copyCharArray(chunk->arena,
+                                                          characters, a + 1);
+            group->bytes = a < 0 ? bytes : a;
+            group->length = length;
+            group->count = 0;
+            group->head = NULL;
+            group->tail = NULL;
+            addGroup(chunk, group);
+            *slot = group;
+        } else if (a >= 0 && ((struct Group *)*slot)->bytes != a) {
+            struct Group *group = *slot;
+            group->pattern = copyCharArray(chunk->arena, characters, a + 1);
+            group->bytes = a;
+        }
+
+        struct Group *group = *slot;
+        struct Occurrence *row = Arena_alloc(chunk->arena,
+                                             sizeof(struct Occurrence));
+        row->next = NULL;
+        row->offset = offset;
+        row->bytes = bytes;
+        row->width = width;
+        row->pixels = NULL;
+        if (a >= 0) {
+            row->pixels = Arena_alloc(chunk->arena, width);
+            memcpy(row->pixels, pixels, width);
+        }
+        if (group->tail == NULL) {
+            group->head = row;
+        } else {
+            group->tail->next = row;
+        }
+        group->tail = row;
+        group->count++;
+
+        chunk->numLines++;
+        offset += bytes + 1;
+    }
+
+    free(characters);
+    free(pixels);
+    STATS_ENTER(PHASE_NONE);
+    return NULL;
+}
+
+/* addGroup
+ *
+ *    Purpose: Remember a group so that it can be walked later
+ * Parameters: The chunk that owns it and the group
+ *    Returns: None
+*/
+static void addGroup(struct Chunk *chunk, struct Group *group)
+{
+    if (chunk->numGroups == chunk->groupCapacity) {
+        chunk->groupCapacity = chunk->groupCapacity > 0
+                             ? 2 * chunk->groupCapacity : 64;
+        chunk->groups = realloc(chunk->groups,
+                           chunk->groupCapacity * sizeof(struct Group *));
+        assert(chunk->groups != NULL);
+    }
+    chunk->groups[chunk->numGroups++] = group;
+}
+
+/* mergeGroups
+ *
+ *    Purpose: Combine the groups of every chunk into one group per pattern
+ *             and find the key
+ * Parameters: The chunks and how many, the arena and table to merge into,
+ *             and a chunk that collects the merged groups
+ *    Returns: The group of the key, or NULL if no pattern repeats
+*/
+static struct Group *mergeGroups(struct Chunk *chunks, int threads,
+                                 Arena_T arena, Fptable_T merged,
+                                 struct Chunk *all)
+{
+    struct Group *key = NULL;
+
+    for (int i = 0; i < threads; i++) {
+        for (size_t g = 0; g < chunks[i].numGroups; g++) {
+            struct Group *group = chunks[i].groups[g];
+            bool found;
+            void **slot = Fptable_hashslot(merged, group->hash,
+                                           group->pattern, group->bytes,
+                                           group->length, false, &found);
+            if (!found) {
+                struct Group *copy = Arena_alloc(arena,
+                                                 sizeof(struct Group));
+                *copy = *group;
+                addGroup(all, copy);
+                *slot = copy;
+                continue;
+            }
+
+            struct Group *into = *slot;
+            into->tail->next = group->head;
+            into->tail = group->tail;
+            into->count += group->count;
+        }
+    }
+
+    for (size_t g = 0; g < all->numGroups; g++) {
+        struct Group *group = all->groups[g];
+        if (group->count < 2) {
+            continue;
+        }
+        if (key == NULL ||
+            group->head->next->offset < key->head->next->offset) {
+            key = group;
+        }
+    }
+    return key;
+}
+
+/* emitRows
+ *
+ *    Purpose: Print the restored image, decoding the rows that were not
+ *             decoded while scanning
+ * Parameters: The mapped input, the merged groups, the key, the scanner
+ *             (NULL for processLine) and the output stream
+ *    Returns: The number of rows written
+*/
+static int emitRows(const char *data, struct Chunk *all, struct Group *key,
+                    Linescan_T scan, FILE *output)
+{
+    size_t numEmits = 0;
+    for (size_t g = 0; g < all->numGroups; g++) {
+        if (all->groups[g]->count >= 2) {
+            numEmits += all->groups[g]->count - 1;
+        }
+    }
+
+    struct Emit *emits = malloc((numEmits + 1) * sizeof(struct Emit));
+    assert(emits != NULL);
+    size_t n = 0;
+    for (size_t g = 0; g < all->numGroups; g++) {
+        struct Occurrence *row = all->groups[g]->head;
+        for (; all->groups[g]->count >= 2 && row->next; row = row->next) {
+            emits[n].tag = row->next->offset;
+            emits[n].row = row;
+            n++;
+        }
+    }
+    qsort(emits, n, sizeof(struct Emit), compareEmits);
+    emits[n].tag = 0;
+    emits[n].row = key->tail;
+    n++;
+
+    size_t scratchSize = 0;
+    for (size_t i = 0; i < n; i++) {
+        if ((size_t)emits[i].row->bytes + 1 + LINESCAN_SLACK > scratchSize) {
+            scratchSize = emits[i].row->bytes + 1 + LINESCAN_SLACK;
+        }
+    }
+    char *characters = malloc(scratchSize);
+    uint8_t *pixels = malloc(scratchSize);
+    assert(characters != NULL && pixels != NULL);
+
+    P5writer_T writer = NULL;
+    for (size_t i = 0; i < n; i++) {
+        struct Occurrence *row = emits[i].row;
+        const uint8_t *rowPixels = row->pixels;
+        int width = row->width;
+        if (rowPixels == NULL) {
+            const char *line = data + row->offset;
+            STATS_ENTER(PHASE_PARSE);
+            if (scan != NULL) {
+                scan(row->bytes, line, pixels, &width, characters);
+            } else {
+                processLine(row->bytes, line, pixels, &width, characters);
+            }
+            STATS_ENTER(PHASE_EMIT);
+            rowPixels = pixels;
+        }
+        if (writer == NULL) {
+            writer = P5writer_new(output, width, n);
+        }
+        P5writer_row(writer, rowPixels, width);
+    }
+    P5writer_close(&writer);
+    free(characters);
+    free(pixels);
+    free(emits);
+    return n;
+}
+
+/* compareEmits
+ *
+ *    Purpose: Order rows by the line that brings them out
+ * Parameters: Two emits
+ *    Returns: Negative, zero or positive, as for qsort
+*/
+static int compareEmits(const void *x, const void *y)
+{
+    const struct Emit *a = x;
+    const struct Emit *b = y;
+    return (a->tag > b->tag) - (a->tag < b->tag);
+}
@@ -0,0 +1,20 @@
+/* 
+ *   parallel.h
+ *   by: Drew Maynard and Joel Brandinger, 01/27/21
+ *   Files, Pictures and Interfaces
+ *
+ *   This file contains the interface for multi-threaded restoration of a
+ *   memory-mapped input. The output is the same as the serial
+ *   restoreLines gives.
+*/
+
+#ifndef PARALLEL_INCLUDED
+#define PARALLEL_INCLUDED
+
+#include <stddef.h>
+#include "uncorrupt.h"
+
+int uncorruptParallel(const char *data, size_t size,
+                      const struct RestoreOptions *options, FILE *output);
+
+#endif
@@ -31,7 +31,7 @@ size_t readaline(FILE *inputfd, char **datapp)
     assert(inputfd != NULL);
     assert(datapp != NULL);
     
-    char currChar = getc(inputfd);
+    int currChar = getc(inputfd);
     int size = 100;
 
     if (currChar == EOF) {
@@ -42,7 +42,7 @@ size_t readaline(FILE *inputfd, char **datapp)
     assert(array != NULL);
     int numBytes = 0;
 
-    while (currChar != 10) {
+    while (currChar != '\n' && currChar != EOF) {
         if (numBytes == size - 1) {
             size = size * 2;
             array = (char*) realloc(array, size * sizeof(char));
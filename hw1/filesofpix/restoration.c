@@ -5,38 +5,259 @@
  *
  *   This file is used to perform operations and run other programs to
  *   uncorrupt and transform the corrupted P2 into a usable P5.
+ *
+ *   Usage: restoration [-s] [-S] [-j threads] [-M budget] [-p depth]
+ *                      [-o output] [filename]
+ *          restoration -b [-S] [-w workers] [-M budget] [-p depth]
+ *                      [-o outdir] [-m manifest] [files...]
+ *
+ *     -s    streaming: write rows out as soon as the original-row pattern
+ *           is known instead of holding the whole file in memory (cannot
+ *           be used with -j, whose threads each hold a chunk)
+ *     -S    print statistics to stderr at the end (see below)
+ *     -j    split a (memory-mapped) file into chunks and restore it with
+ *           this many threads; pipes and stdin are always done serially
+ *     -M    keep memory under this many bytes (a k, m or g suffix may be
+ *           used): once the key is known and the budget is used up, rows
+ *           go out as soon as they are known (through a temporary file
+ *           when the output is a pipe), lines with patterns not seen
+ *           before are dropped, and the file is read without threads
+ *     -p    read ahead with a background thread, keeping up to this many
+ *           megabyte blocks ready for the parser (for slow storage);
+ *           cannot be used with -j, whose threads read their own chunks
+ *     -o    write the image to this file (with a large buffer) instead of
+ *           stdout; in batch mode, the directory for the results
+ *     -b    batch: restore every file named on the command line (and in
+ *           the manifest, one name per line) with a pool of workers.
+ *           Each result goes to NAME.restored.pgm, in outdir if given,
+ *           and a per-file report is printed to stderr. A batch where two
+ *           files would go to the same result is refused.
+ *
+ *   A filename of "-" reads the corrupted image from stdin. Setting
+ *   RESTORATION_SCANNER to "avx2", "sse2" or "scalar" forces the way lines
+ *   are split (the fastest one available is used otherwise). Setting
+ *   RESTORATION_STATS does the same as -S: one line of JSON is printed to
+ *   stderr with the number of files, bytes, lines and rows, the number of
+ *   distinct patterns and slots in the fingerprint tables and how full
+ *   they were, the time, mallocs and bytes allocated while reading,
+ *   hashing, parsing and emitting, and how long the parser waited on the
+ *   background reader and the other way around. Everything is added up
+ *   over all the files.
 */
 
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-#include "readaline.h"
 #include "uncorrupt.h"
+#include "batch.h"
+#include "stats.h"
 #include <assert.h>
 
+#define DEFAULT_WORKERS 4
+#define OUTPUT_BUFSIZE (1 << 20)
+
 FILE *openFile(char *filename);
-void printString(char *string);
+FILE *openOutput(char *filename);
+int restore(char *filename, struct RestoreOptions *options, FILE *output);
+void addFile(char ***filenames, int *numFiles, char *filename);
+void freeFiles(char **filenames, int numFiles);
+void readManifest(char *manifest, char ***filenames, int *numFiles);
+size_t parseSize(char *text);
+void usage(char *program);
 
 int main(int argc, char **argv)
 {
-    assert(argc < 3);
+    struct RestoreOptions options;
+    options.streaming = false;
+    options.scanner = getenv("RESTORATION_SCANNER");
+    options.threads = 1;
+    options.budget = 0;
+    options.prefetch = 0;
+    bool batch = false;
+    int workers = DEFAULT_WORKERS;
+    char *outname = NULL;
+    char **filenames = NULL;
+    int numFiles = 0;
+
+    Stats_init();
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0) {
+            options.streaming = true;
+        } else if (strcmp(argv[i], "-S") == 0) {
+            Stats_enabled = true;
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            options.threads = atoi(argv[++i]);
+            if (options.threads < 1) {
+                usage(argv[0]);
+            }
+        } else if (strcmp(argv[i], "-M") == 0 && i + 1 < argc) {
+            options.budget = parseSize(argv[++i]);
+            if (options.budget == 0) {
+                usage(argv[0]);
+            }
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            options.prefetch = atoi(argv[++i]);
+            if (options.prefetch < 1) {
+                usage(argv[0]);
+            }
+        } else if (strcmp(argv[i], "-b") == 0) {
+            batch = true;
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+            if (workers < 1) {
+                usage(argv[0]);
+            }
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outname = argv[++i];
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            batch = true;
+            readManifest(argv[++i], &filenames, &numFiles);
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            usage(argv[0]);
+        } else {
+            addFile(&filenames, &numFiles, strdup(argv[i]));
+        }
+    }
+
+    if (options.threads > 1 && (options.streaming || options.prefetch > 0)) {
+        usage(argv[0]);
+    }
+
+    if (batch) {
+        int failures = restoreBatch(filenames, numFiles, outname, workers,
+                                    &options);
+        freeFiles(filenames, numFiles);
+        if (Stats_enabled) {
+            Stats_report(stderr);
+        }
+        return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (numFiles > 1) {
+        usage(argv[0]);
+    }
+
+    FILE *output = outname != NULL ? openOutput(outname) : stdout;
+    int rows;
     
-    if (argc == 1) {
-        char filename[1000];
+    if (numFiles == 0) {
+        char name[1000];
         printf("%s", "Enter file to restore: ");
-        scanf("%s", filename);
-        FILE *fp = openFile(filename);
-        uncorrupt(fp);
-        fclose(fp);
-        return EXIT_SUCCESS;
+        scanf("%s", name);
+        rows = restore(name, &options, output);
     } else {
-        FILE *fp = openFile(argv[1]);
-        uncorrupt(fp);
-        fclose(fp);
-        return EXIT_SUCCESS;
+        rows = restore(filenames[0], &options, output);
+        freeFiles(filenames, numFiles);
     } 
 
-    return 0;
+    STATS_ENTER(PHASE_EMIT);
+    if (output != stdout) {
+        fclose(output);
+    } else {
+        fflush(output);
+    }
+    if (Stats_enabled) {
+        Stats_report(stderr);
+    }
+    /* nothing recovered is a failure, as it is for a file of a batch */
+    return rows > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* restore
+ *
+ *    Purpose: Restore one file. Regular files are memory-mapped so that the
+ *             lines are never copied; pipes, terminals and "-" (stdin) fall
+ *             back to reading the stream.
+ * Parameters: The name of the file, the options for the run and where the
+ *             image goes
+ *    Returns: The number of rows written, or 0 if no original rows could
+ *             be found
+*/
+int restore(char *filename, struct RestoreOptions *options, FILE *output)
+{
+    FILE *fp = NULL;
+    Linereader_T reader = NULL;
+
+    STATS_ENTER(PHASE_READ);
+    if (strcmp(filename, "-") == 0) {
+        reader = Linereader_new(stdin, 0);
+    } else {
+        reader = Linereader_map(filename);
+    }
+    if (reader == NULL) {
+        fp = openFile(filename);
+        reader = Linereader_new(fp, 0);
+    }
+
+    struct Restoration run;
+    initRestoration(&run);
+    int rows = restoreLines(&run, reader, options, output);
+    freeRestoration(&run);
+
+    Linereader_free(&reader);
+    if (fp != NULL) {
+        fclose(fp);
+    }
+    return rows;
+}
+
+/* addFile
+ *
+ *    Purpose: Add a name to the list of files to restore
+ * Parameters: References to the list and its length, and the name, which
+ *             the list takes (it is freed by freeFiles)
+ *    Returns: None
+*/
+void addFile(char ***filenames, int *numFiles, char *filename)
+{
+    assert(filename != NULL);
+    if ((*numFiles & (*numFiles - 1)) == 0) {
+        int capacity = *numFiles > 0 ? 2 * *numFiles : 1;
+        *filenames = realloc(*filenames, capacity * sizeof(char *));
+        assert(*filenames != NULL);
+    }
+    (*filenames)[(*numFiles)++] = filename;
+}
+
+/* freeFiles
+ *
+ *    Purpose: Free the list of files to restore and every name in it
+ * Parameters: The list and its length
+ *    Returns: None
+*/
+void freeFiles(char **filenames, int numFiles)
+{
+    for (int i = 0; i < numFiles; i++) {
+        free(filenames[i]);
+    }
+    free(filenames);
+}
+
+/* readManifest
+ *
+ *    Purpose: Add every file named in a manifest (one per line, blank
+ *             lines skipped) to the list of files to restore
+ * Parameters: The name of the manifest and references to the list and its
+ *             length
+ *    Returns: None
+*/
+void readManifest(char *manifest, char ***filenames, int *numFiles)
+{
+    FILE *fp = openFile(manifest);
+    Linereader_T reader = Linereader_new(fp, 0);
+    char *line = NULL;
+    size_t capacity = 0;
+    size_t length;
+
+    while (Linereader_read(reader, &line, &capacity, &length)) {
+        if (length > 0) {
+            addFile(filenames, numFiles, strdup(line));
+        }
+    }
+
+    free(line);
+    Linereader_free(&reader);
+    fclose(fp);
 }
 
 /* openFile
@@ -53,3 +274,60 @@ FILE *openFile(char *filename)
     return fp;
 }
 
+/* openOutput
+ *
+ *    Purpose: Open the output file with a large buffer
+ * Parameters: The name of the file
+ *    Returns: A pointer to the file stream that was opened
+*/
+FILE *openOutput(char *filename)
+{
+    FILE *fp = fopen(filename, "wb");
+    assert(fp != NULL);
+    setvbuf(fp, NULL, _IOFBF, OUTPUT_BUFSIZE);
+    return fp;
+}
+
+/* parseSize
+ *
+ *    Purpose: Read a number of bytes, which may end in k, m or g
+ * Parameters: The text
+ *    Returns: The number of bytes, or 0 if the text is not a size
+*/
+size_t parseSize(char *text)
+{
+    char *end;
+    unsigned long long size = strtoull(text, &end, 10);
+    if (end == text) {
+        return 0;
+    }
+    switch (*end) {
+    case 'g': case 'G':
+        size <<= 10;
+        /* fall through */
+    case 'm': case 'M':
+        size <<= 10;
+        /* fall through */
+    case 'k': case 'K':
+        size <<= 10;
+        end++;
+        break;
+    }
+    return *end == '\0' ? size : 0;
+}
+
+/* usage
+ *
+ *    Purpose: Explain how to run the program and quit
+ * Parameters: The name of the program
+ *    Returns: None (exits)
+*/
+void usage(char *program)
+{
+    fprintf(stderr, "Usage: %s [-s] [-S] [-j threads] [-M budget] "
+                    "[-p depth] [-o output] [filename]\n"
+                    "       %s -b [-S] [-w workers] [-M budget] "
+                    "[-p depth] [-o outdir] [-m manifest] [files...]\n",
+            program, program);
+    exit(EXIT_FAILURE);
+}
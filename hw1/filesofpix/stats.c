@@ -0,0 +1,200 @@
+/* 
+ *   stats.c
+ *   by: Drew Maynard and Joel Brandinger, 01/27/21
+ *   Files, Pictures and Interfaces
+ *
+ *   This file contains the implementation of restoration's phase
+ *   statistics. Allocations are counted by wrapping malloc, calloc and
+ *   realloc at link time (see the -Wl,--wrap flags in the Makefile), so
+ *   every allocation made by restoration and the libraries linked into
+ *   it statically is seen, not just the ones in our own code. Each thread
+ *   has its own current phase and the totals are updated atomically, so
+ *   the parallel and batch modes add up the time all their threads spent
+ *   in each phase.
+*/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "stats.h"
+
+bool Stats_enabled = false;
+
+static const char *phaseNames[NUM_PHASES] = {
+    "other", "read", "hash", "parse", "emit"
+};
+
+static const char *counterNames[NUM_COUNTERS] = {
+    "files", "bytes", "lines", "rows", "patterns", "slots"
+};
+
+static __thread enum Phase current = PHASE_NONE;
+static __thread uint64_t started;
+static uint64_t nanoseconds[NUM_PHASES];
+static uint64_t mallocs[NUM_PHASES];
+static uint64_t bytes[NUM_PHASES];
+static uint64_t counters[NUM_COUNTERS];
+static uint64_t parserWaited;
+static uint64_t readerWaited;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *pointer, size_t size);
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t count, size_t size);
+void *__wrap_realloc(void *pointer, size_t size);
+
+static uint64_t now(void);
+static void count(size_t size);
+
+/* Stats_init
+ *
+ *    Purpose: Turn statistics on if RESTORATION_STATS is set (restoration
+ *             also sets Stats_enabled itself for -S)
+ * Parameters: None
+ *    Returns: None
+*/
+extern void Stats_init(void)
+{
+    const char *setting = getenv("RESTORATION_STATS");
+    Stats_enabled = setting != NULL && setting[0] != '\0' &&
+                    setting[0] != '0';
+    started = now();
+}
+
+/* Stats_enter
+ *
+ *    Purpose: Charge the time since the last switch to the current phase
+ *             and make another phase current
+ * Parameters: The phase being entered
+ *    Returns: The phase that was current, so that it can be gone back to
+*/
+extern enum Phase Stats_enter(enum Phase phase)
+{
+    uint64_t t = now();
+    if (started != 0) {
+        __atomic_fetch_add(&nanoseconds[current], t - started,
+                           __ATOMIC_RELAXED);
+    }
+    enum Phase previous = current;
+    started = t;
+    current = phase;
+    return previous;
+}
+
+/* Stats_count
+ *
+ *    Purpose: Add to one of the counters
+ * Parameters: The counter and how much to add
+ *    Returns: None
+*/
+extern void Stats_count(enum Counter counter, uint64_t amount)
+{
+    __atomic_fetch_add(&counters[counter], amount, __ATOMIC_RELAXED);
+}
+
+/* Stats_waits
+ *
+ *    Purpose: Add up the time a run's parser spent waiting for input and
+ *             its background reader spent waiting for the parser
+ * Parameters: The two times, in seconds
+ *    Returns: None
+*/
+extern void Stats_waits(double parserWait, double readerWait)
+{
+    __atomic_fetch_add(&parserWaited, (uint64_t)(parserWait * 1e9),
+                       __ATOMIC_RELAXED);
+    __atomic_fetch_add(&readerWaited, (uint64_t)(readerWait * 1e9),
+                       __ATOMIC_RELAXED);
+}
+
+/* Stats_report
+ *
+ *    Purpose: Print the statistics as one line of JSON
+ * Parameters: The stream to print to
+ *    Returns: None
+*/
+extern void Stats_report(FILE *fp)
+{
+    Stats_enter(current);
+    fprintf(fp, "{");
+    for (int c = 0; c < COUNTER_PATTERNS; c++) {
+        fprintf(fp, "\"%s\":%llu,", counterNames[c],
+                (unsigned long long)__atomic_load_n(&counters[c],
+                                                    __ATOMIC_RELAXED));
+    }
+    uint64_t patterns = __atomic_load_n(&counters[COUNTER_PATTERNS],
+                                        __ATOMIC_RELAXED);
+    uint64_t slots = __atomic_load_n(&counters[COUNTER_SLOTS],
+                                     __ATOMIC_RELAXED);
+    fprintf(fp, "\"table\":{\"patterns\":%llu,\"slots\":%llu,"
+                "\"load\":%.4f},", (unsigned long long)patterns,
+            (unsigned long long)slots,
+            slots > 0 ? (double)patterns / slots : 0.0);
+    fprintf(fp, "\"phases\":{");
+    for (int p = PHASE_READ; p < NUM_PHASES; p++) {
+        fprintf(fp, "%s\"%s\":{\"seconds\":%.6f,\"mallocs\":%llu,"
+                    "\"bytes\":%llu}", p > PHASE_READ ? "," : "",
+                phaseNames[p],
+                __atomic_load_n(&nanoseconds[p], __ATOMIC_RELAXED) / 1e9,
+                (unsigned long long)__atomic_load_n(&mallocs[p],
+                                                    __ATOMIC_RELAXED),
+                (unsigned long long)__atomic_load_n(&bytes[p],
+                                                    __ATOMIC_RELAXED));
+    }
+    fprintf(fp, "},\"waits\":{\"parser\":%.6f,\"reader\":%.6f}}\n",
+            __atomic_load_n(&parserWaited, __ATOMIC_RELAXED) / 1e9,
+            __atomic_load_n(&readerWaited, __ATOMIC_RELAXED) / 1e9);
+}
+
+/* __wrap_malloc, __wrap_calloc, __wrap_realloc
+ *
+ *    Purpose: Count an allocation against the current phase and pass it
+ *             on to the real allocator
+ * Parameters: As for malloc, calloc and realloc
+ *    Returns: As for malloc, calloc and realloc
+*/
+void *__wrap_malloc(size_t size)
+{
+    count(size);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    count(n * size);
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *pointer, size_t size)
+{
+    count(size);
+    return __real_realloc(pointer, size);
+}
+
+/* count
+ *
+ *    Purpose: Record one allocation
+ * Parameters: Its size
+ *    Returns: None
+*/
+static void count(size_t size)
+{
+    if (Stats_enabled) {
+        __atomic_fetch_add(&mallocs[current], 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&bytes[current], size, __ATOMIC_RELAXED);
+    }
+}
+
+/* now
+ *
+ *    Purpose: Read the monotonic clock
+ * Parameters: None
+ *    Returns: The time in nanoseconds
+*/
+static uint64_t now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
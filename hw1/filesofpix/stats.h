@@ -0,0 +1,59 @@
+/* 
+ *   stats.h
+ *   by: Drew Maynard and Joel Brandinger, 01/27/21
+ *   Files, Pictures and Interfaces
+ *
+ *   This file contains the interface for restoration's phase statistics.
+ *   Time and allocations are charged to whichever phase is current: read
+ *   (finding lines), hash (fingerprinting them and looking them up), parse
+ *   (splitting the lines that need it into pixels) and emit. Counters
+ *   such as the number of lines and the size of the fingerprint table are
+ *   added up over every file. When RESTORATION_STATS is set in the
+ *   environment (or restoration is given -S) a report is printed to
+ *   stderr at the end; otherwise STATS_ENTER does nothing but test a flag,
+ *   and the counters are only added once per file.
+ *   The time the parser and the background reader (-p) spent waiting for
+ *   each other is added up over every file and reported as well.
+*/
+
+#ifndef STATS_INCLUDED
+#define STATS_INCLUDED
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+enum Phase {
+    PHASE_NONE,
+    PHASE_READ,
+    PHASE_HASH,
+    PHASE_PARSE,
+    PHASE_EMIT,
+    NUM_PHASES
+};
+
+enum Counter {
+    COUNTER_FILES,
+    COUNTER_BYTES,
+    COUNTER_LINES,
+    COUNTER_ROWS,
+    COUNTER_PATTERNS,
+    COUNTER_SLOTS,
+    NUM_COUNTERS
+};
+
+extern bool Stats_enabled;
+
+#define STATS_ENTER(phase) do {                                         \
+        if (Stats_enabled) {                                            \
+                Stats_enter(phase);                                     \
+        }                                                               \
+} while (0)
+
+extern void Stats_init(void);
+extern enum Phase Stats_enter(enum Phase phase);
+extern void Stats_count(enum Counter counter, uint64_t amount);
+extern void Stats_waits(double parserWait, double readerWait);
+extern void Stats_report(FILE *fp);
+
+#endif
@@ -7,96 +7,423 @@
  *   them, and give back the uncorrupted lines.
 */
 
-#include "readaline.h"
+#include "linereader.h"
 #include "uncorrupt.h"
+#include "parallel.h"
+#include "stats.h"
 #include <stdlib.h>
 #include <stdio.h>
-#include <atom.h>
-#include <list.h>
-#include <table.h>
 #include <stdbool.h>
 #include <string.h>
 #include "seq.h"
 #include <assert.h>
 
-/* uncorrupt()
+/* With a memory budget the fingerprint table starts with room for one
+ * line per this many bytes of budget, and grows from there if it must */
+#define BUDGET_PER_LINE 256
+
+/* initRestoration()
  *
- *    Purpose: Perform all functions to uncorrupt an image
- * Parameters: A pointer to the input file
+ *    Purpose: Set up the state for restoring one or more files. The arena
+ *             and scratch buffers are kept from one file to the next.
+ * Parameters: The restoration state to set up
  *    Returns: None
 */
-void uncorrupt(FILE *fp)
+void initRestoration(struct Restoration *run)
 {
-    char *datapp;
-    Table_T table = Table_new(100, NULL, NULL);
-    Seq_T lines = Seq_new(0);
-    char *key = NULL;
-    
-    int bytes = readaline(fp, &datapp);
-    hash_to_table(datapp, &table, bytes, &lines, &key);
+    run->arena = Arena_new(0);
+    run->table = NULL;
+    run->lines = NULL;
+    run->key = NULL;
+    run->keyLength = 0;
+    run->keyHash = 0;
+    run->mapped = false;
+    run->characters = NULL;
+    run->pixels = NULL;
+    run->scratchSize = 0;
+    run->scan = NULL;
+    run->fingerprint = NULL;
+    run->streaming = false;
+    run->budget = 0;
+    run->spilled = false;
+    run->writer = NULL;
+    run->output = NULL;
+}
+
+/* freeRestoration()
+ *
+ *    Purpose: Deallocate everything the restoration state still holds
+ * Parameters: The restoration state
+ *    Returns: None
+*/
+void freeRestoration(struct Restoration *run)
+{
+    free(run->characters);
+    free(run->pixels);
+    Arena_free(&run->arena);
+}
 
-    while (datapp != NULL) {
-        int bytes = readaline(fp, &datapp);
-        hash_to_table(datapp, &table, bytes, &lines, &key);
+/* restoreLines()
+ *
+ *    Purpose: Restore one image. Lines are only ever looked at in place,
+ *             never copied. A mapped input is handed to uncorruptParallel
+ *             when more than one thread is asked for; otherwise the reader
+ *             is given a background thread to read ahead, if one is asked
+ *             for.
+ * Parameters: The restoration state, the line reader, the options for the
+ *             run (NULL for the defaults), and where the image goes
+ *    Returns: The number of rows written, or 0 if no original rows could
+ *             be found
+*/
+int restoreLines(struct Restoration *run, Linereader_T reader,
+                 const struct RestoreOptions *options, FILE *output)
+{
+    const char *datapp;
+    size_t bytes;
+    int numRows = 0;
+
+    if (options != NULL && options->threads > 1 && options->budget == 0) {
+        datapp = Linereader_data(reader, &bytes);
+        if (datapp != NULL) {
+            STATS_ENTER(PHASE_HASH);
+            numRows = uncorruptParallel(datapp, bytes, options, output);
+            STATS_ENTER(PHASE_NONE);
+            countRun(numRows);
+            return numRows;
+        }
     }
 
-    getLastElement(&table, &lines, key); 
-    int numRows = Seq_length(lines);
-    printList(lines, numRows, Seq_length(Seq_get(lines, 0)));
+    size_t hint = expectedLines(reader);
+    if (options != NULL && options->budget > 0 &&
+        hint > options->budget / BUDGET_PER_LINE) {
+        hint = options->budget / BUDGET_PER_LINE;
+    }
+    run->table = Fptable_new(run->arena, hint);
+    run->lines = Seq_new(0);
+    run->key = NULL;
+    run->keyLength = 0;
+    run->mapped = Linereader_data(reader, &bytes) != NULL;
+    run->scan = Linescan_select(options != NULL ? options->scanner : NULL);
+    run->fingerprint = Linescan_hasher(run->scan);
+    run->streaming = options != NULL && options->streaming;
+    run->budget = options != NULL ? options->budget : 0;
+    run->spilled = false;
+    run->writer = NULL;
+    run->output = output;
+    if (options != NULL && options->prefetch > 0) {
+        Linereader_prefetch(reader, options->prefetch);
+    }
 
-    free(key);
-    freeSequence(lines);
-    Table_map(table, tFree, NULL);
-    Table_free(&table); 
+    size_t numLines = 0;
+    size_t numBytes = 0;
+    STATS_ENTER(PHASE_READ);
+    while (Linereader_next(reader, &datapp, &bytes)) {
+        STATS_ENTER(PHASE_HASH);
+        numLines++;
+        numBytes += bytes + 1;
+        hash_to_table(datapp, bytes, run);
+        if (run->budget > 0) {
+            Linereader_release(reader);
+            if (!run->spilled && !run->streaming && run->key != NULL &&
+                Arena_size(run->arena) > run->budget) {
+                spill(run);
+            }
+        }
+        STATS_ENTER(PHASE_READ);
+    }
+    if (Stats_enabled) {
+        double parserWait, readerWait;
+        Linereader_waits(reader, &parserWait, &readerWait);
+        Stats_waits(parserWait, readerWait);
+        size_t size = Linereader_size(reader);
+        Stats_count(COUNTER_BYTES, size > 0 ? size : numBytes);
+        Stats_count(COUNTER_LINES, numLines);
+        Stats_count(COUNTER_PATTERNS, Fptable_length(run->table));
+        Stats_count(COUNTER_SLOTS, Fptable_capacity(run->table));
+    }
+
+    STATS_ENTER(PHASE_EMIT);
+    if (run->spilled) {
+        Line last = Fptable_get(run->table, run->key, run->keyLength);
+        P5writer_row(run->writer, last->row->pixels, last->row->width);
+        numRows = P5writer_close(&run->writer);
+    } else if (run->writer != NULL) {
+        numRows = P5writer_close(&run->writer);
+    } else if (run->key != NULL) {
+        getLastElement(run);
+        numRows = Seq_length(run->lines);
+        Row first = Seq_get(run->lines, 0);
+        printList(output, run->lines, numRows, first->width);
+    } else {
+        fprintf(stderr, "restoration: no original rows found\n");
+    }
+
+    Seq_free(&run->lines);
+    run->table = NULL;
+    Arena_reset(run->arena);
+    STATS_ENTER(PHASE_NONE);
+    countRun(numRows);
+    return numRows;
 }
 
 /* hash_to_table()
  *
- *    Purpose: Hashes the sequence from corrupted image into the table
- * Parameters: A pointer to the line of characters and the table
+ *    Purpose: Hashes the sequence from corrupted image into the table.
+ *             The line is fingerprinted in one pass and only split into
+ *             its pixels and pattern if a line with the same fingerprint
+ *             has been seen; the patterns are then compared exactly.
+ * Parameters: A pointer to the line of characters (owned by the reader),
+ *             its length, and the state of the restoration run
  *    Returns: None
 */
-void hash_to_table(char *datapp, Table_T *table, int bytes, Seq_T *list, \
-                   char **key)
+void hash_to_table(const char *datapp, int bytes, struct Restoration *run)
 {
-    if (datapp == NULL) {
+    size_t length;
+    uint64_t hash = run->fingerprint(datapp, bytes, &length);
+    int width;
+
+    if (run->streaming && run->writer != NULL) {
+        if (hash == run->keyHash && (int)length == run->keyLength) {
+            int a = decodeLine(run, datapp, bytes, &width);
+            if (memcmp(run->characters, run->key, a) == 0) {
+                P5writer_row(run->writer, run->pixels, width);
+            }
+        }
+        return;
+    }
+
+    bool found;
+    void **slot;
+    if (!Fptable_has(run->table, hash, length)) {
+        if (run->spilled) {
+            return;
+        }
+        const char *stable = run->mapped
+                           ? datapp
+                           : copyCharArray(run->arena, datapp, bytes);
+        slot = Fptable_hashslot(run->table, hash, stable, bytes, length,
+                                false, &found);
+        Line line = Arena_alloc(run->arena, sizeof(struct Line));
+        line->data = stable;
+        line->bytes = bytes;
+        line->row = NULL;
+        *slot = line;
         return;
     }
-    
-    Seq_T numbers = Seq_new(0);
-    char *characters = (char*)malloc(bytes * sizeof(char));
-    assert(characters != NULL); 
-    int a = processLine(bytes, datapp, &numbers, characters);
-    
-    const char *sequence;
-    sequence = Atom_string(characters);
 
-    if (Table_get(*table, sequence) != NULL) {
-        Seq_addhi(*list, Table_put(*table, sequence, numbers));
-        if (*key == NULL) {
-            *key = copyCharArray(characters, a + 1);
+    int a = decodeLine(run, datapp, bytes, &width);
+    slot = Fptable_hashslot(run->table, hash, run->characters, a, a, true,
+                            &found);
+    if (run->spilled) {
+        if (found) {
+            spillLine(run, *slot, width);
         }
+        return;
+    }
+    Row current = keepRow(run, width);
+    if (!found) {
+        Line line = Arena_alloc(run->arena, sizeof(struct Line));
+        line->row = current;
+        *slot = line;
+        return;
+    }
+
+    bool first = run->key == NULL;
+    if (first) {
+        run->key = copyCharArray(run->arena, run->characters, a + 1);
+        run->keyLength = a;
+        run->keyHash = hash;
+    }
+
+    Line line = *slot;
+    Row previous = line->row;
+    if (previous == NULL) {
+        decodeLine(run, line->data, line->bytes, &width);
+        previous = keepRow(run, width);
+    }
+
+    if (first && run->streaming) {
+        startStream(run, previous);
+        P5writer_row(run->writer, current->pixels, current->width);
+        return;
+    }
+    Seq_addhi(run->lines, previous);
+    line->row = current;
+}
+
+/* spill
+ *
+ *    Purpose: Stop holding the image in memory: write out the rows
+ *             collected so far and send every later row straight to the
+ *             writer
+ * Parameters: The restoration run, which must know its key
+ *    Returns: None
+*/
+void spill(struct Restoration *run)
+{
+    Row first = Seq_get(run->lines, 0);
+    run->writer = P5writer_new(run->output, first->width, -1);
+    for (int i = 0; i < Seq_length(run->lines); i++) {
+        Row row = Seq_get(run->lines, i);
+        P5writer_row(run->writer, row->pixels, row->width);
+    }
+    Seq_free(&run->lines);
+    run->lines = Seq_new(0);
+    run->spilled = true;
+}
+
+/* spillLine
+ *
+ *    Purpose: Handle a repeated pattern once the run has spilled. The
+ *             earlier row with the pattern is written out and the current
+ *             one (still in the scratch buffer) takes its place, in the
+ *             same memory when it fits.
+ * Parameters: The restoration run, the table entry of the pattern, and
+ *             the number of pixels in the current line
+ *    Returns: None
+*/
+void spillLine(struct Restoration *run, Line line, int width)
+{
+    if (line->row == NULL) {
+        Row current = keepRow(run, width);
+        int previous;
+        decodeLine(run, line->data, line->bytes, &previous);
+        P5writer_row(run->writer, run->pixels, previous);
+        line->row = current;
+        return;
+    }
+
+    P5writer_row(run->writer, line->row->pixels, line->row->width);
+    if (line->row->width >= width) {
+        memcpy(line->row->pixels, run->pixels, width);
+        line->row->width = width;
     } else {
-        Table_put(*table, sequence, numbers);
+        line->row = keepRow(run, width);
     }
-    free(datapp);
-    free(characters);
+}
+
+/* decodeLine
+ *
+ *    Purpose: Split a line into the scratch buffers
+ * Parameters: The restoration run, the line and its length, and a
+ *             reference that is set to the number of pixels
+ *    Returns: The length of the pattern, which is left in run->characters
+ *             (the pixels are in run->pixels)
+*/
+int decodeLine(struct Restoration *run, const char *datapp, int bytes,
+               int *width)
+{
+    enum Phase outer = PHASE_NONE;
+    if (Stats_enabled) {
+        outer = Stats_enter(PHASE_PARSE);
+    }
+
+    growScratch(run, bytes + 1 + LINESCAN_SLACK);
+    int a = run->scan != NULL
+          ? run->scan(bytes, datapp, run->pixels, width, run->characters)
+          : processLine(bytes, datapp, run->pixels, width, run->characters);
+
+    STATS_ENTER(outer);
+    return a;
+}
+
+/* countRun
+ *
+ *    Purpose: Count a finished run in the statistics (if they are on).
+ *             Its lines and table are counted by whoever read them.
+ * Parameters: The number of rows written
+ *    Returns: None
+*/
+void countRun(int numRows)
+{
+    if (Stats_enabled) {
+        Stats_count(COUNTER_FILES, 1);
+        Stats_count(COUNTER_ROWS, numRows);
+    }
+}
+
+/* keepRow
+ *
+ *    Purpose: Copy the pixels of the line just decoded into a row in the
+ *             arena
+ * Parameters: The restoration run and the number of pixels
+ *    Returns: The row
+*/
+Row keepRow(struct Restoration *run, int width)
+{
+    Row row = Arena_alloc(run->arena, sizeof(struct Row) + width);
+    row->width = width;
+    memcpy(row->pixels, run->pixels, width);
+    return row;
+}
+
+/* startStream
+ *
+ *    Purpose: Start writing the image the moment the key is found. The
+ *             earlier row with the key goes out first; the caller writes
+ *             the current row after it.
+ * Parameters: The restoration run and the earlier row
+ *    Returns: None
+*/
+void startStream(struct Restoration *run, Row previous)
+{
+    run->writer = P5writer_new(run->output, previous->width, -1);
+    P5writer_row(run->writer, previous->pixels, previous->width);
+}
+
+/* expectedLines
+ *
+ *    Purpose: Guess how many lines the input has so that the fingerprint
+ *             table can be sized before the first line is read. Lines of
+ *             the test images run from several hundred to a few thousand
+ *             bytes, so this errs on the side of too many.
+ * Parameters: The line reader
+ *    Returns: The estimated number of lines
+*/
+size_t expectedLines(Linereader_T reader)
+{
+    return Linereader_size(reader) / 256 + 16;
+}
+
+/* growScratch
+ *
+ *    Purpose: Make sure the per-line scratch buffers can hold a line
+ * Parameters: The restoration run and the number of bytes needed
+ *    Returns: None
+*/
+void growScratch(struct Restoration *run, size_t bytes)
+{
+    if (bytes <= run->scratchSize) {
+        return;
+    }
+
+    size_t size = run->scratchSize > 0 ? run->scratchSize : 128;
+    while (size < bytes) {
+        size = size * 2;
+    }
+    run->characters = (char*) realloc(run->characters, size * sizeof(char));
+    run->pixels = (uint8_t*) realloc(run->pixels, size * sizeof(uint8_t));
+    assert(run->characters != NULL && run->pixels != NULL);
+    run->scratchSize = size;
 }
 
 /* proccessLine
  *
  *    Purpose: Uses the line given and splits the characters into two lists:
                One containing the characters in the line and the other
-               finds the characters that are integers, converts them to int,
-               and adds them to the list.
+               finds the characters that are integers, converts them to
+               pixel values, and adds them to the row.
  * Parameters: The number of characters in the line, a pointer to the line,
-               and the addresses of the char and int lists
+               the pixel buffer, a reference to the number of pixels found
+               and the char buffer. Both buffers hold at least bytes + 1.
  *    Returns: The number of characters in the char list
 */
-int processLine(int bytes, char *datapp, Seq_T *numbers, char *characters)
+int processLine(int bytes, const char *datapp, uint8_t *pixels, int *width,
+                char *characters)
 {
     char currChar;
     int a = 0;
+    int n = 0;
 
     for (int i = 0; i < bytes; i++) {
         currChar = datapp[i];
@@ -106,20 +433,19 @@ int processLine(int bytes, char *datapp, Seq_T *numbers, char *characters)
         } else {
             int x = currChar - 48;
             int counter = 1;
-            while (isDigit(datapp[i + counter])) {
+            while (i + counter < bytes && isDigit(datapp[i + counter])) {
                 currChar = datapp[i + counter];
                 x = x * 10 + (currChar - 48);
                 counter++;
             }
             i = i + counter - 1;
-            int *val = (int*) malloc(sizeof(int));
-            assert(val != NULL);
-            *val = x;
-            Seq_addhi(*numbers, val);
+            pixels[n] = (uint8_t)x;
+            n++;
         }
     } 
 
     characters[a] = '\0';
+    *width = n;
     return a;
 }
 
@@ -139,104 +465,47 @@ bool isDigit(char c)
 
 /* copyCharArray
  *
- *    Purpose: Add values of existing array to an array with space on the
- *             heap.
- * Parameters: An array to copy and a reference to a pointer with the space
- *    Returns: None, will update arrays values.
+ *    Purpose: Add values of existing array to an array with space in the
+ *             arena.
+ * Parameters: The arena, an array to copy and the number of bytes to copy
+ *    Returns: The copy
 */
-char *copyCharArray(char *array, int memorySize)
+char *copyCharArray(Arena_T arena, const char *array, int memorySize)
 {
-    char *newArray = (char*) malloc(memorySize * sizeof(char));
-    assert(newArray != NULL);
+    char *newArray = Arena_alloc(arena, memorySize * sizeof(char));
     memcpy(newArray, array, memorySize * sizeof(char));
-    assert(newArray != NULL);
     
     return newArray;
 }
 
 /* printToCout
  *
- *    Purpose: Print the contents of the list in P5 format
- * Parameters: The list, the number of rows, number of columns to print
+ *    Purpose: Print the contents of the list in P5 format. The rows are
+ *             already contiguous, so they go to the writer whole.
+ * Parameters: The output stream, the list, the number of rows, number of
+ *             columns to print
  *    Returns: None
 */
-void printList(Seq_T list, int numRows, int numColumns)
+void printList(FILE *output, Seq_T list, int numRows, int numColumns)
 {
-    printf("%s\n%d %d\n%d\n", "P5", numColumns, numRows, 255);
+    P5writer_T writer = P5writer_new(output, numColumns, numRows);
 
     for (int i = 0; i < numRows; i++) {
-        printIntSequence(Seq_get(list, i), numColumns);
-    }
-}
-
-/* print
- *
- * Helper Function for printToCout
- *
- *    Purpose: Prints the elements of the arrays
- * Parameters: The array and the size of each array
- *    Returns: None
-*/
-void printIntSequence(Seq_T seq, int size)
-{
-    for (int i = 0; i < size; i++) {
-        printf("%c", *(int*)Seq_get(seq, i));
+        Row row = Seq_get(list, i);
+        P5writer_row(writer, row->pixels, row->width);
     }
+    P5writer_close(&writer);
 }
 
 /* getLastElement
  *
- *    Purpose: Gets the last element in the table that was left and adds
- *             to list
- * Parameters: The table, the list, and the sequence to check
- *    Returns: None
-*/
-void getLastElement(Table_T *table, Seq_T *list, char *sequence)
-{
-    const char *key = Atom_string(sequence);
-    Seq_addhi(*list, Table_get(*table, key));
-    Table_remove(*table, key);
-}
-
-/* tFree
- *
- *    Purpose: Dealocate the memory in the table
- * Parameters: The key and value pairs
- *    Returns: None
-*/
-void tFree(const void *key, void **value, void *cl)
-{
-    Seq_T *seq = (Seq_T*)value;
-    freeNumbers(*seq);
-    (void)key;
-    (void)cl;
-}
-
-/* freeSequence
- *
- *    Purpose: Dealocate the memory in the sequence of sequences
- * Parameters: The sequence
- *    Returns: None
-*/
-void freeSequence(Seq_T seq)
-{
-    for (int i = 0; i < Seq_length(seq); i++) {
-        freeNumbers(Seq_get(seq, i));
-    }
-    Seq_free(&seq);
-}
-
-/* freeNumbers
- *
- *    Purpose: Dealocate the numbers in the inner sequence
- * Parameters: The sequence
+ *    Purpose: Gets the last line with the key that was left in the table,
+ *             decodes it and adds it to the list
+ * Parameters: The restoration run
  *    Returns: None
 */
-void freeNumbers(Seq_T seq)
+void getLastElement(struct Restoration *run)
 {
-    for (int i = 0; i < Seq_length(seq); i++) {
-        free((int*)Seq_get(seq, i));
-    }
-    Seq_free(&seq);
+    Line last = Fptable_get(run->table, run->key, run->keyLength);
+    Seq_addhi(run->lines, last->row);
 }
-
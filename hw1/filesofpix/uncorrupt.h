@@ -6,23 +6,104 @@
  *   This file contains the interface for the uncorrupt program
 */
 
-#include <atom.h>
-#include <list.h>
-#include <table.h>
+#ifndef UNCORRUPT_INCLUDED
+#define UNCORRUPT_INCLUDED
+
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <seq.h>
+#include "arena.h"
+#include "fptable.h"
+#include "linereader.h"
+#include "linescan.h"
+#include "p5writer.h"
+
+/* One decoded line: its pixel values, stored contiguously in the arena */
+typedef struct Row {
+    int width;
+    uint8_t pixels[];
+} *Row;
+
+/* The most recent line with a pattern. It points into the mapped input,
+ * or into a copy in the arena when the input is a stream, until its
+ * pattern is seen again; from then on it is decoded as soon as it is read
+ * and the row is kept instead. */
+typedef struct Line {
+    const char *data;
+    int bytes;
+    Row row;
+} *Line;
+
+/* Everything one restoration run allocates. The rows and the key live in
+ * the arena and are released together when the run is over (the arena
+ * keeps its chunks for the next file); the scratch buffers are reused
+ * from line to line and from file to file. The table maps each pattern to
+ * the most recent line that had it. Every line is fingerprinted in one
+ * fused pass; it is only decoded (by the vectorized scanner if there is
+ * one, and by processLine if not) when its fingerprint is already in the
+ * table, so junk lines are never split, and never copied out of a mapped
+ * input.
+ *
+ * In streaming mode the writer is started as soon as the key is known;
+ * from then on rows with the key are written straight out of the scratch
+ * buffer and every other line is dropped.
+ *
+ * With a memory budget, the run spills once the arena outgrows it (and
+ * the key is known): the rows collected so far go to a writer of unknown
+ * height, which stages them in a temporary file if the output cannot be
+ * rewound, and every later row follows them as soon as it is known. Each
+ * pattern keeps one row buffer that is reused, lines with patterns that
+ * were never seen before are dropped as junk, and the pages of a mapped
+ * input are given back as they are read, so memory stops growing. */
+struct Restoration {
+    Arena_T arena;
+    Fptable_T table;
+    Seq_T lines;
+    char *key;
+    int keyLength;
+    uint64_t keyHash;
+    bool mapped;
+    char *characters;
+    uint8_t *pixels;
+    size_t scratchSize;
+    Linescan_T scan;
+    Linehash_T fingerprint;
+    bool streaming;
+    size_t budget;
+    bool spilled;
+    P5writer_T writer;
+    FILE *output;
+};
 
-void uncorrupt(FILE *fp);
-void hash_to_table(char *datapp, Table_T *table, int bytes, Seq_T *list,
-                   char **key);
-int processLine(int bytes, char *datapp, Seq_T *numbers, char *characters);
+/* How a restoration run should behave (see restoration.c for the flags) */
+struct RestoreOptions {
+    bool streaming;
+    const char *scanner;
+    int threads;
+    size_t budget;
+    int prefetch;
+};
+
+void initRestoration(struct Restoration *run);
+void freeRestoration(struct Restoration *run);
+int restoreLines(struct Restoration *run, Linereader_T reader,
+                 const struct RestoreOptions *options, FILE *output);
+void hash_to_table(const char *datapp, int bytes, struct Restoration *run);
+int processLine(int bytes, const char *datapp, uint8_t *pixels, int *width,
+                char *characters);
 bool isDigit(char c);
-void printList(Seq_T list, int numRows, int numColumns);
-void printIntSequence(Seq_T seq, int size);
-void getLastElement(Table_T *table, Seq_T *list, char *sequence);
-void freeList(List_T list, int size);
-char *copyCharArray(char *array, int memorySize);
-void tFree(const void *key, void **value, void *cl);
-void freeSequence(Seq_T seq);
-void freeNumbers(Seq_T seq);
+void printList(FILE *output, Seq_T list, int numRows, int numColumns);
+void getLastElement(struct Restoration *run);
+char *copyCharArray(Arena_T arena, const char *array, int memorySize);
+void growScratch(struct Restoration *run, size_t bytes);
+int decodeLine(struct Restoration *run, const char *datapp, int bytes,
+               int *width);
+Row keepRow(struct Restoration *run, int width);
+void startStream(struct Restoration *run, Row previous);
+void spill(struct Restoration *run);
+void spillLine(struct Restoration *run, Line line, int width);
+size_t expectedLines(Linereader_T reader);
+void countRun(int numRows);
+
+#endif
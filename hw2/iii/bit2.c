@@ -5,19 +5,28 @@
  *
  * This file contains the implementation for the bit2 data structure
  *
+ * NOTE: The bits are kept in one array of 64-bit words, words_per_row
+ *       words to a row, rather than in a Hanson Bit_T, so that a row can
+ *       be handed out as a plain array of words.
+ *
 */
 
 #include <stdlib.h>
 #include "bit2.h"
 
 #define T Bit2_T
+#define WORD_BITS 64
 
 struct T {
     int width;
     int height;
-    Bit_T array;
+    int words_per_row;
+    uint64_t last_mask;
+    uint64_t *words;
 };
 
+static uint64_t *word_at(T bit2, int col, int row);
+
 /* Bit2_new
  *
  *      Purpose: Allocate, initialize, and return a new 2-dimensional array
@@ -44,7 +53,14 @@ extern T Bit2_new(int width, int height)
     assert(new_array != NULL);
     new_array->width = width;
     new_array->height = height;
-    new_array->array = Bit_new(width * height);
+    new_array->words_per_row = (width + WORD_BITS - 1) / WORD_BITS;
+    new_array->last_mask = width % WORD_BITS == 0
+                         ? ~(uint64_t)0
+                         : ((uint64_t)1 << (width % WORD_BITS)) - 1;
+    /* calloc(0) may return NULL, so an empty image still gets a word */
+    size_t numWords = (size_t)new_array->words_per_row * height;
+    new_array->words = calloc(numWords > 0 ? numWords : 1, sizeof(uint64_t));
+    assert(new_array->words != NULL);
 
     return new_array;
 }
@@ -64,8 +80,9 @@ extern T Bit2_new(int width, int height)
 extern void Bit2_free(T *bit2)
 {
     assert(*bit2);
-    Bit_free(&(*bit2)->array);
+    free((*bit2)->words);
     free(*bit2);
+    *bit2 = NULL;
 }
 
 /* Bit2_width
@@ -126,8 +143,7 @@ extern int Bit2_get(T bit2, int col, int row)
     assert(row < bit2->height);
     assert(col >= 0 && row >= 0);
  
-    int index = col + (row * bit2->width);
-    return Bit_get(bit2->array, index);
+    return (*word_at(bit2, col, row) >> (col % WORD_BITS)) & 1;
 }
 
 
@@ -155,9 +171,135 @@ extern int Bit2_put(T bit2, int col, int row, int bit)
     assert(col < bit2->width);
     assert(row < bit2->height);
     assert(col >= 0 && row >= 0);
+    assert(bit == 0 || bit == 1);
  
-    int index = col + (row * bit2->width);
-    return Bit_put(bit2->array, index, bit);
+    uint64_t *word = word_at(bit2, col, row);
+    uint64_t mask = (uint64_t)1 << (col % WORD_BITS);
+    int previous = (*word & mask) != 0;
+    *word = (*word & ~mask) | ((uint64_t)bit << (col % WORD_BITS));
+    return previous;
+}
+
+/* Bit2_words
+ *
+ *      Purpose: Return the number of 64-bit words each row is packed into.
+ *
+ *   Parameters: The pointer to the instance of Bit2.
+ *
+ *      Returns: The number of words in a row.
+ *
+ * Expectations: Bit array is not null.
+ *
+*/
+extern int Bit2_words(T bit2)
+{
+    assert(bit2);
+    return bit2->words_per_row;
+}
+
+/* Bit2_getword
+ *
+ *      Purpose: Access 64 bits of a row at once. Bit k of word w is the
+ *               pixel in column 64 * w + k.
+ *
+ *   Parameters: The pointer to the instance of Bit2, the index of the word
+ *               in the row, and the row number.
+ *
+ *      Returns: The word. Bits past the end of the row are 0.
+ *
+ * Expectations: The word and row are within the bounds of the array, bit2
+ *               is not null.
+ *
+*/
+extern uint64_t Bit2_getword(T bit2, int word, int row)
+{
+    assert(bit2);
+    assert(word >= 0 && word < bit2->words_per_row);
+    assert(row >= 0 && row < bit2->height);
+
+    return bit2->words[(size_t)row * bit2->words_per_row + word];
+}
+
+/* Bit2_putword
+ *
+ *      Purpose: Place 64 bits of a row at once. Bits past the end of the
+ *               row are dropped.
+ *
+ *   Parameters: The pointer to the instance of Bit2, the index of the word
+ *               in the row, the row number, and the bits.
+ *
+ *      Returns: The previous value of the word.
+ *
+ * Expectations: The word and row are within the bounds of the array, bit2
+ *               is not null.
+ *
+*/
+extern uint64_t Bit2_putword(T bit2, int word, int row, uint64_t bits)
+{
+    assert(bit2);
+    assert(word >= 0 && word < bit2->words_per_row);
+    assert(row >= 0 && row < bit2->height);
+
+    if (word == bit2->words_per_row - 1) {
+        bits &= bit2->last_mask;
+    }
+    uint64_t *place = &bit2->words[(size_t)row * bit2->words_per_row + word];
+    uint64_t previous = *place;
+    *place = bits;
+    return previous;
+}
+
+/* Bit2_row
+ *
+ *      Purpose: Give direct access to the packed words of a row, for code
+ *               that works on many words at a time.
+ *
+ *   Parameters: The pointer to the instance of Bit2 and the row number.
+ *
+ *      Returns: A pointer to the Bit2_words(bit2) words of the row. It is
+ *               valid until the array is freed.
+ *
+ * Expectations: The row is within the bounds of the array, bit2 is not
+ *               null. Callers that write through the pointer must leave
+ *               the bits past the end of the row 0.
+ *
+*/
+extern uint64_t *Bit2_row(T bit2, int row)
+{
+    assert(bit2);
+    assert(row >= 0 && row < bit2->height);
+
+    return &bit2->words[(size_t)row * bit2->words_per_row];
+}
+
+/* Bit2_map_words
+ *
+ *      Purpose: Traverse the words of the 2D array in row major order.
+ *
+ *   Parameters: The instance of Bit2, the function to be applied to each
+ *               word (which may change the word through its pointer), the
+ *               folding variable if needed.
+ * 
+ *      Returns: None.
+ *
+ * Expectations: Bit array is not null. Bits set past the end of a row are
+ *               cleared after apply returns.
+ *
+*/
+extern void Bit2_map_words(T bit2, void (apply(int word, int row, T bit2,
+    uint64_t *bits, void *cl)), void *cl)
+{
+    assert(bit2);
+    int last = bit2->words_per_row - 1;
+    for (int j = 0; j < bit2->height; j++) {
+        uint64_t *words = Bit2_row(bit2, j);
+        for (int w = 0; w <= last; w++) {
+            apply(w, j, bit2, &words[w], cl);
+        }
+        if (last >= 0) {
+            words[last] &= bit2->last_mask;
+        }
+    }
 }
 
 /* Bit2_map_row_major
@@ -178,8 +320,7 @@ extern void Bit2_map_row_major(T bit2, void (apply(int i, int j, T bit2,
     assert(bit2);
     for (int j = 0; j < bit2->height; j++) {
         for (int i = 0; i < bit2->width; i++) {
-             int index = i + (j * bit2->width);
-             apply(i, j, bit2, Bit_get(bit2->array, index), cl);
+             apply(i, j, bit2, Bit2_get(bit2, i, j), cl);
         }
     }
 }
@@ -202,12 +343,61 @@ extern void Bit2_map_col_major(T bit2, void (apply(int i, int j, T bit2,
     assert(bit2);
     for (int i = 0; i < bit2->width; i++) {
         for (int j = 0; j < bit2->height; j++) {
-             int index = i + (j * bit2->width);
-             apply(i, j, bit2, Bit_get(bit2->array, index), cl);
+             apply(i, j, bit2, Bit2_get(bit2, i, j), cl);
         }
     }
 }
 
+/* Bit2_map_set
+ *
+ *      Purpose: Traverse only the set (black) elements of the 2D array, in
+ *               row major order. Zero words are skipped whole and the set
+ *               bits of a word are found with count trailing zeros, so the
+ *               cost grows with the number of set bits, not the area.
+ *
+ *   Parameters: The instance of Bit2, the function to be applied to each
+ *               set element, the folding variable if needed.
+ *
+ *      Returns: None.
+ *
+ * Expectations: Bit array is not null. Apply may change the array, but
+ *               each word is read before its first bit is visited, so
+ *               changes to the word being visited are not seen.
+ *
+*/
+extern void Bit2_map_set(T bit2, void (apply(int i, int j, T bit2,
+    void *cl)), void *cl)
+{
+    assert(bit2);
+    for (int j = 0; j < bit2->height; j++) {
+        const uint64_t *words = Bit2_row(bit2, j);
+        for (int w = 0; w < bit2->words_per_row; w++) {
+            uint64_t bits = words[w];
+            while (bits != 0) {
+                apply(w * WORD_BITS + __builtin_ctzll(bits), j, bit2, cl);
+                bits &= bits - 1;
+            }
+        }
+    }
+}
+
+/* word_at
+ *
+ *      Purpose: Find the word that holds a pixel.
+ *
+ *   Parameters: The instance of Bit2, the column and the row.
+ *
+ *      Returns: A pointer to the word.
+ *
+ * Expectations: The index has been checked by the caller.
+ *
+*/
+static uint64_t *word_at(T bit2, int col, int row)
+{
+    return &bit2->words[(size_t)row * bit2->words_per_row +
+                        col / WORD_BITS];
+}
+
 
 
 
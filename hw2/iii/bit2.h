@@ -5,13 +5,18 @@
  *
  * This file contains the interface for the bit2 data structure.
  *
+ * Each row is packed into 64-bit words, with the leftmost pixel of a word
+ * in its least significant bit. Rows start on a word boundary, and the
+ * bits past the end of a row are always 0, so whole words can be read,
+ * written and mapped over 64 pixels at a time.
+ *
 */
 
 #ifndef BIT2_INCLUDED
 #define BIT2_INCLUDED
 
 #include "assert.h"
-#include <bit.h>
+#include <stdint.h>
 
 #define T Bit2_T
 typedef struct T *T;
@@ -25,10 +30,19 @@ extern int Bit2_height(T bit2);
 extern int Bit2_get(T bit2, int col, int row);
 extern int Bit2_put(T bit2, int col, int row, int bit);
 
+extern int Bit2_words(T bit2);
+extern uint64_t Bit2_getword(T bit2, int word, int row);
+extern uint64_t Bit2_putword(T bit2, int word, int row, uint64_t bits);
+extern uint64_t *Bit2_row(T bit2, int row);
+
+extern void Bit2_map_words(T bit2, void (apply(int word, int row, T bit2,
+    uint64_t *bits, void *cl)), void *cl);
 extern void Bit2_map_row_major(T bit2, void (apply(int i, int j, T bit2,
     int bit, void *cl)), void *cl);
 extern void Bit2_map_col_major(T bit2, void (apply(int i, int j, T bit2,
     int bit, void *cl)), void *cl);
+extern void Bit2_map_set(T bit2, void (apply(int i, int j, T bit2,
+    void *cl)), void *cl);
 
 #undef T 
 #endif
\ No newline at end of file
@@ -0,0 +1,658 @@
+/* bit2ops.c
+ *
+ * By: Drew Maynard and Joel Brandinger, 02/08/22
+ * Interfaces, Implementations, and Images (iii)
+ *
+ * This file contains the implementation for whole-image operations on
+ * bitmaps.
+ *
+ * NOTE: A pixel's left and right neighbors are the bits below and above
+ *       it, so horizontal moves are word shifts that carry one bit over
+ *       from the next word, and vertical moves are whole rows. Dilate and
+ *       erode keep copies of the three rows around the one being written,
+ *       which is what lets the destination be the source.
+ *
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "bit2ops.h"
+
+static void checkSizes(Bit2_T a, Bit2_T b);
+static uint64_t lastMask(Bit2_T bitmap);
+static void spreadRow(uint64_t *out, const uint64_t *in, int numWords,
+                      uint64_t last, bool dilate);
+static void neighborhood(Bit2_T dst, Bit2_T src, int connectivity,
+                         bool dilate);
+static bool growRow(Bit2_T marker, Bit2_T mask, int row, int from,
+                    int connectivity, uint64_t *seeds);
+static void fillRow(uint64_t *bits, const uint64_t *allowed, int numWords);
+static uint64_t fillUp(uint64_t bits, uint64_t allowed);
+static uint64_t fillDown(uint64_t bits, uint64_t allowed);
+
+/* Bit2ops_and
+ *
+ *      Purpose: Set each pixel of dst to the AND of the pixels of a and b.
+ *
+ *   Parameters: The destination and the two sources.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The bitmaps are not null and have the same dimensions.
+ *
+*/
+extern void Bit2ops_and(Bit2_T dst, Bit2_T a, Bit2_T b)
+{
+    checkSizes(dst, a);
+    checkSizes(dst, b);
+    int numWords = Bit2_words(dst);
+
+    for (int row = 0; row < Bit2_height(dst); row++) {
+        uint64_t *out = Bit2_row(dst, row);
+        const uint64_t *x = Bit2_row(a, row);
+        const uint64_t *y = Bit2_row(b, row);
+        for (int w = 0; w < numWords; w++) {
+            out[w] = x[w] & y[w];
+        }
+    }
+}
+
+/* Bit2ops_or
+ *
+ *      Purpose: Set each pixel of dst to the OR of the pixels of a and b.
+ *
+ *   Parameters: The destination and the two sources.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The bitmaps are not null and have the same dimensions.
+ *
+*/
+extern void Bit2ops_or(Bit2_T dst, Bit2_T a, Bit2_T b)
+{
+    checkSizes(dst, a);
+    checkSizes(dst, b);
+    int numWords = Bit2_words(dst);
+
+    for (int row = 0; row < Bit2_height(dst); row++) {
+        uint64_t *out = Bit2_row(dst, row);
+        const uint64_t *x = Bit2_row(a, row);
+        const uint64_t *y = Bit2_row(b, row);
+        for (int w = 0; w < numWords; w++) {
+            out[w] = x[w] | y[w];
+        }
+    }
+}
+
+/* Bit2ops_xor
+ *
+ *      Purpose: Set each pixel of dst to the XOR of the pixels of a and b.
+ *
+ *   Parameters: The destination and the two sources.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The bitmaps are not null and have the same dimensions.
+ *
+*/
+extern void Bit2ops_xor(Bit2_T dst, Bit2_T a, Bit2_T b)
+{
+    checkSizes(dst, a);
+    checkSizes(dst, b);
+    int numWords = Bit2_words(dst);
+
+    for (int row = 0; row < Bit2_height(dst); row++) {
+        uint64_t *out = Bit2_row(dst, row);
+        const uint64_t *x = Bit2_row(a, row);
+        const uint64_t *y = Bit2_row(b, row);
+        for (int w = 0; w < numWords; w++) {
+            out[w] = x[w] ^ y[w];
+        }
+    }
+}
+
+/* Bit2ops_not
+ *
+ *      Purpose: Set each pixel of dst to the inverse of the pixel of src.
+ *
+ *   Parameters: The destination and the source.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The bitmaps are not null and have the same dimensions.
+ *
+*/
+extern void Bit2ops_not(Bit2_T dst, Bit2_T src)
+{
+    checkSizes(dst, src);
+    int numWords = Bit2_words(dst);
+    uint64_t last = lastMask(dst);
+
+    for (int row = 0; row < Bit2_height(dst); row++) {
+        uint64_t *out = Bit2_row(dst, row);
+        const uint64_t *in = Bit2_row(src, row);
+        for (int w = 0; w < numWords; w++) {
+            out[w] = ~in[w];
+        }
+        if (numWords > 0) {
+            out[numWords - 1] &= last;
+        }
+    }
+}
+
+/* Bit2ops_shiftLeft
+ *
+ *      Purpose: Move every pixel one column to the left. The last column
+ *               becomes white.
+ *
+ *   Parameters: The destination and the source.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The bitmaps are not null and have the same dimensions.
+ *
+*/
+extern void Bit2ops_shiftLeft(Bit2_T dst, Bit2_T src)
+{
+    checkSizes(dst, src);
+    int numWords = Bit2_words(dst);
+
+    for (int row = 0; row < Bit2_height(dst); row++) {
+        uint64_t *out = Bit2_row(dst, row);
+        const uint64_t *in = Bit2_row(src, row);
+        for (int w = 0; w < numWords; w++) {
+            uint64_t next = w + 1 < numWords ? in[w + 1] : 0;
+            out[w] = in[w] >> 1 | next << 63;
+        }
+    }
+}
+
+/* Bit2ops_shiftRight
+ *
+ *      Purpose: Move every pixel one column to the right. The first column
+ *               becomes white.
+ *
+ *   Parameters: The destination and the source.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The bitmaps are not null and have the same dimensions.
+ *
+*/
+extern void Bit2ops_shiftRight(Bit2_T dst, Bit2_T src)
+{
+    checkSizes(dst, src);
+    int numWords = Bit2_words(dst);
+    uint64_t last = lastMask(dst);
+
+    for (int row = 0; row < Bit2_height(dst); row++) {
+        uint64_t *out = Bit2_row(dst, row);
+        const uint64_t *in = Bit2_row(src, row);
+        /* Right to left, so a word is read before it is overwritten */
+        for (int w = numWords - 1; w >= 0; w--) {
+            uint64_t previous = w > 0 ? in[w - 1] : 0;
+            out[w] = in[w] << 1 | previous >> 63;
+        }
+        if (numWords > 0) {
+            out[numWords - 1] &= last;
+        }
+    }
+}
+
+/* Bit2ops_shiftUp
+ *
+ *      Purpose: Move every pixel one row up. The last row becomes white.
+ *
+ *   Parameters: The destination and the source.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The bitmaps are not null and have the same dimensions.
+ *
+*/
+extern void Bit2ops_shiftUp(Bit2_T dst, Bit2_T src)
+{
+    checkSizes(dst, src);
+    int height = Bit2_height(dst);
+    size_t rowBytes = Bit2_words(dst) * sizeof(uint64_t);
+    if (height == 0 || rowBytes == 0) {
+        return;
+    }
+
+    for (int row = 0; row + 1 < height; row++) {
+        memmove(Bit2_row(dst, row), Bit2_row(src, row + 1), rowBytes);
+    }
+    memset(Bit2_row(dst, height - 1), 0, rowBytes);
+}
+
+/* Bit2ops_shiftDown
+ *
+ *      Purpose: Move every pixel one row down. The first row becomes white.
+ *
+ *   Parameters: The destination and the source.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The bitmaps are not null and have the same dimensions.
+ *
+*/
+extern void Bit2ops_shiftDown(Bit2_T dst, Bit2_T src)
+{
+    checkSizes(dst, src);
+    int height = Bit2_height(dst);
+    size_t rowBytes = Bit2_words(dst) * sizeof(uint64_t);
+    if (height == 0 || rowBytes == 0) {
+        return;
+    }
+
+    for (int row = height - 1; row > 0; row--) {
+        memmove(Bit2_row(dst, row), Bit2_row(src, row - 1), rowBytes);
+    }
+    memset(Bit2_row(dst, 0), 0, rowBytes);
+}
+
+/* Bit2ops_dilate
+ *
+ *      Purpose: Make every pixel black that is black or has a black
+ *               neighbor.
+ *
+ *   Parameters: The destination, the source, and the connectivity.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The bitmaps are not null and have the same dimensions,
+ *               connectivity is 4 or 8.
+ *
+*/
+extern void Bit2ops_dilate(Bit2_T dst, Bit2_T src, int connectivity)
+{
+    neighborhood(dst, src, connectivity, true);
+}
+
+/* Bit2ops_erode
+ *
+ *      Purpose: Keep only the black pixels whose neighbors are all black.
+ *               Pixels on the border of the image always become white.
+ *
+ *   Parameters: The destination, the source, and the connectivity.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The bitmaps are not null and have the same dimensions,
+ *               connectivity is 4 or 8.
+ *
+*/
+extern void Bit2ops_erode(Bit2_T dst, Bit2_T src, int connectivity)
+{
+    neighborhood(dst, src, connectivity, false);
+}
+
+/* Bit2ops_count
+ *
+ *      Purpose: Count the black pixels of a bitmap.
+ *
+ *   Parameters: The bitmap.
+ *
+ *      Returns: The number of black pixels.
+ *
+ * Expectations: The bitmap is not null.
+ *
+*/
+extern uint64_t Bit2ops_count(Bit2_T bitmap)
+{
+    assert(bitmap != NULL);
+    int numWords = Bit2_words(bitmap);
+    uint64_t count = 0;
+
+    for (int row = 0; row < Bit2_height(bitmap); row++) {
+        const uint64_t *in = Bit2_row(bitmap, row);
+        for (int w = 0; w < numWords; w++) {
+            count += __builtin_popcountll(in[w]);
+        }
+    }
+    return count;
+}
+
+/* Bit2ops_reconstruct
+ *
+ *      Purpose: Grow the marker inside the mask until it stops changing,
+ *               so that it holds every component of the mask it touched.
+ *               Rows are grown from the row above from top to bottom, then
+ *               from the row below from bottom to top, and each grown row
+ *               is filled along its runs of the mask, so most images are
+ *               done after one or two rounds.
+ *
+ *   Parameters: The marker, which is replaced by the result, the mask, and
+ *               the connectivity.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The bitmaps are not null and have the same dimensions,
+ *               connectivity is 4 or 8.
+ *
+*/
+extern void Bit2ops_reconstruct(Bit2_T marker, Bit2_T mask,
+                                int connectivity)
+{
+    assert(connectivity == 4 || connectivity == 8);
+    checkSizes(marker, mask);
+    int height = Bit2_height(marker);
+    int numWords = Bit2_words(marker);
+    if (height == 0 || numWords == 0) {
+        return;
+    }
+
+    Bit2ops_and(marker, marker, mask);
+    uint64_t *seeds = malloc(numWords * sizeof(uint64_t));
+    assert(seeds != NULL);
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int row = 0; row < height; row++) {
+            changed |= growRow(marker, mask, row, row - 1, connectivity,
+                               seeds);
+        }
+        for (int row = height - 1; row >= 0; row--) {
+            changed |= growRow(marker, mask, row, row + 1, connectivity,
+                               seeds);
+        }
+    }
+    free(seeds);
+}
+
+/* Bit2ops_removeBorder
+ *
+ *      Purpose: Clear every black pixel connected to the border of the
+ *               image, by reconstructing the image from its border pixels
+ *               and taking what was found out of it.
+ *
+ *   Parameters: The bitmap and the connectivity.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The bitmap is not null, connectivity is 4 or 8.
+ *
+*/
+extern void Bit2ops_removeBorder(Bit2_T bitmap, int connectivity)
+{
+    assert(bitmap != NULL);
+    int width = Bit2_width(bitmap);
+    int height = Bit2_height(bitmap);
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    Bit2_T marker = Bit2_new(width, height);
+    size_t rowBytes = Bit2_words(bitmap) * sizeof(uint64_t);
+    memcpy(Bit2_row(marker, 0), Bit2_row(bitmap, 0), rowBytes);
+    memcpy(Bit2_row(marker, height - 1), Bit2_row(bitmap, height - 1),
+           rowBytes);
+    for (int row = 1; row < height - 1; row++) {
+        Bit2_put(marker, 0, row, Bit2_get(bitmap, 0, row));
+        Bit2_put(marker, width - 1, row, Bit2_get(bitmap, width - 1, row));
+    }
+
+    Bit2ops_reconstruct(marker, bitmap, connectivity);
+    Bit2ops_xor(bitmap, bitmap, marker);
+    Bit2_free(&marker);
+}
+
+/* neighborhood
+ *
+ *      Purpose: Dilate or erode a bitmap a row at a time. Each source row
+ *               is copied and spread (dilated or eroded along the row)
+ *               before the row above it is written; the result combines
+ *               the spread row with the rows above and below it, spread
+ *               too for corner neighbors.
+ *
+ *   Parameters: The destination, the source, the connectivity, and true to
+ *               dilate or false to erode.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The bitmaps are not null and have the same dimensions,
+ *               connectivity is 4 or 8.
+ *
+*/
+static void neighborhood(Bit2_T dst, Bit2_T src, int connectivity,
+                         bool dilate)
+{
+    assert(connectivity == 4 || connectivity == 8);
+    checkSizes(dst, src);
+    int height = Bit2_height(dst);
+    int numWords = Bit2_words(dst);
+    if (height == 0 || numWords == 0) {
+        return;
+    }
+
+    uint64_t last = lastMask(dst);
+    size_t rowBytes = numWords * sizeof(uint64_t);
+    uint64_t *buffer = calloc(6 * (size_t)numWords, sizeof(uint64_t));
+    assert(buffer != NULL);
+    /* Index 0 is the row above, 1 this row, 2 the row below; rows outside
+     * the image stay all 0 */
+    uint64_t *rows[3], *spread[3];
+    for (int i = 0; i < 3; i++) {
+        rows[i] = buffer + i * numWords;
+        spread[i] = buffer + (3 + i) * numWords;
+    }
+    memcpy(rows[1], Bit2_row(src, 0), rowBytes);
+    spreadRow(spread[1], rows[1], numWords, last, dilate);
+
+    for (int row = 0; row < height; row++) {
+        if (row + 1 < height) {
+            memcpy(rows[2], Bit2_row(src, row + 1), rowBytes);
+            spreadRow(spread[2], rows[2], numWords, last, dilate);
+        } else {
+            memset(rows[2], 0, rowBytes);
+            memset(spread[2], 0, rowBytes);
+        }
+
+        uint64_t *out = Bit2_row(dst, row);
+        const uint64_t *up = connectivity == 8 ? spread[0] : rows[0];
+        const uint64_t *down = connectivity == 8 ? spread[2] : rows[2];
+        const uint64_t *middle = spread[1];
+        if (dilate) {
+            for (int w = 0; w < numWords; w++) {
+                out[w] = up[w] | middle[w] | down[w];
+            }
+        } else {
+            for (int w = 0; w < numWords; w++) {
+                out[w] = up[w] & middle[w] & down[w];
+            }
+        }
+
+        uint64_t *oldRow = rows[0];
+        uint64_t *oldSpread = spread[0];
+        rows[0] = rows[1];
+        rows[1] = rows[2];
+        rows[2] = oldRow;
+        spread[0] = spread[1];
+        spread[1] = spread[2];
+        spread[2] = oldSpread;
+    }
+    free(buffer);
+}
+
+/* spreadRow
+ *
+ *      Purpose: Dilate or erode one row along itself: each pixel is OR-ed
+ *               or AND-ed with its left and right neighbors.
+ *
+ *   Parameters: Where the result goes (may be the input), the input row,
+ *               its number of words, the mask of the last word, and true
+ *               to dilate or false to erode.
+ *
+ *      Returns: None.
+ *
+ * Expectations: numWords > 0.
+ *
+*/
+static void spreadRow(uint64_t *out, const uint64_t *in, int numWords,
+                      uint64_t last, bool dilate)
+{
+    uint64_t carry = 0;
+    for (int w = 0; w < numWords; w++) {
+        uint64_t bits = in[w];
+        uint64_t next = w + 1 < numWords ? in[w + 1] : 0;
+        uint64_t fromLeft = bits << 1 | carry;
+        uint64_t fromRight = bits >> 1 | next << 63;
+        out[w] = dilate ? bits | fromLeft | fromRight
+                        : bits & fromLeft & fromRight;
+        carry = bits >> 63;
+    }
+    out[numWords - 1] &= last;
+}
+
+/* growRow
+ *
+ *      Purpose: Add to a row of the marker the pixels of the mask that
+ *               touch the marker in a neighboring row, then fill along the
+ *               runs of the mask.
+ *
+ *   Parameters: The marker, the mask, the row to grow, the row to grow
+ *               from (which may be outside the image), the connectivity,
+ *               and a scratch row.
+ *
+ *      Returns: Whether the row changed.
+ *
+ * Expectations: None.
+ *
+*/
+static bool growRow(Bit2_T marker, Bit2_T mask, int row, int from,
+                    int connectivity, uint64_t *seeds)
+{
+    int numWords = Bit2_words(marker);
+    uint64_t *bits = Bit2_row(marker, row);
+    const uint64_t *allowed = Bit2_row(mask, row);
+
+    if (from < 0 || from >= Bit2_height(marker)) {
+        memcpy(seeds, bits, numWords * sizeof(uint64_t));
+    } else {
+        const uint64_t *near = Bit2_row(marker, from);
+        if (connectivity == 8) {
+            spreadRow(seeds, near, numWords, lastMask(marker), true);
+        } else {
+            memcpy(seeds, near, numWords * sizeof(uint64_t));
+        }
+        for (int w = 0; w < numWords; w++) {
+            seeds[w] = (seeds[w] | bits[w]) & allowed[w];
+        }
+    }
+    fillRow(seeds, allowed, numWords);
+
+    bool changed = false;
+    for (int w = 0; w < numWords; w++) {
+        changed |= seeds[w] != bits[w];
+        bits[w] = seeds[w];
+    }
+    return changed;
+}
+
+/* fillRow
+ *
+ *      Purpose: Spread the set bits of a row along the runs of allowed
+ *               bits they are in: rightward word by word, then leftward,
+ *               carrying a bit into the next word when a run crosses over.
+ *
+ *   Parameters: The bits (within allowed), the allowed bits, and the
+ *               number of words in the row.
+ *
+ *      Returns: None.
+ *
+ * Expectations: None.
+ *
+*/
+static void fillRow(uint64_t *bits, const uint64_t *allowed, int numWords)
+{
+    uint64_t carry = 0;
+    for (int w = 0; w < numWords; w++) {
+        bits[w] = fillUp(bits[w] | (carry & allowed[w]), allowed[w]);
+        carry = bits[w] >> 63;
+    }
+    carry = 0;
+    for (int w = numWords - 1; w >= 0; w--) {
+        bits[w] = fillDown(bits[w] | (carry << 63 & allowed[w]),
+                           allowed[w]);
+        carry = bits[w] & 1;
+    }
+}
+
+/* fillUp
+ *
+ *      Purpose: Spread set bits toward the high end of a word through the
+ *               allowed bits, doubling the distance covered each step.
+ *
+ *   Parameters: The bits (within allowed) and the allowed bits.
+ *
+ *      Returns: The filled bits.
+ *
+ * Expectations: None.
+ *
+*/
+static uint64_t fillUp(uint64_t bits, uint64_t allowed)
+{
+    for (int step = 1; step < 64; step *= 2) {
+        bits |= allowed & bits << step;
+        allowed &= allowed << step;
+    }
+    return bits;
+}
+
+/* fillDown
+ *
+ *      Purpose: Spread set bits toward the low end of a word through the
+ *               allowed bits, doubling the distance covered each step.
+ *
+ *   Parameters: The bits (within allowed) and the allowed bits.
+ *
+ *      Returns: The filled bits.
+ *
+ * Expectations: None.
+ *
+*/
+static uint64_t fillDown(uint64_t bits, uint64_t allowed)
+{
+    for (int step = 1; step < 64; step *= 2) {
+        bits |= allowed & bits >> step;
+        allowed &= allowed >> step;
+    }
+    return bits;
+}
+
+/* checkSizes
+ *
+ *      Purpose: Check that two bitmaps have the same dimensions.
+ *
+ *   Parameters: The bitmaps.
+ *
+ *      Returns: None.
+ *
+ * Expectations: Both are not null (checked).
+ *
+*/
+static void checkSizes(Bit2_T a, Bit2_T b)
+{
+    assert(a != NULL && b != NULL);
+    assert(Bit2_width(a) == Bit2_width(b));
+    assert(Bit2_height(a) == Bit2_height(b));
+}
+
+/* lastMask
+ *
+ *      Purpose: Find which bits of the last word of a row are pixels.
+ *
+ *   Parameters: The bitmap.
+ *
+ *      Returns: The mask of the pixels of the last word.
+ *
+ * Expectations: None.
+ *
+*/
+static uint64_t lastMask(Bit2_T bitmap)
+{
+    int extra = Bit2_width(bitmap) % 64;
+    return extra == 0 ? ~(uint64_t)0 : ((uint64_t)1 << extra) - 1;
+}
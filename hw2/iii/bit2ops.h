@@ -0,0 +1,47 @@
+/* bit2ops.h
+ *
+ * By: Drew Maynard and Joel Brandinger, 02/08/22
+ * Interfaces, Implementations, and Images (iii)
+ *
+ * This file contains the interface for whole-image operations on bitmaps.
+ * Every operation works on the packed 64-bit words of the rows instead of
+ * one pixel at a time, in loops simple enough for the compiler to
+ * vectorize. Pixels outside the image count as white (0).
+ *
+ * The destination of every operation may be one of its sources, and all
+ * the bitmaps given to one operation must have the same dimensions.
+ * Connectivity is 4 (edge neighbors) or 8 (edge and corner neighbors).
+ *
+ * Reconstruction grows a marker inside a mask until it has taken every
+ * component of the mask that it touches, so the black connected to the
+ * border of an image is found by reconstructing the image from its own
+ * border pixels, and removed with a XOR.
+ *
+*/
+
+#ifndef BIT2OPS_INCLUDED
+#define BIT2OPS_INCLUDED
+
+#include <stdint.h>
+#include "bit2.h"
+
+extern void Bit2ops_and(Bit2_T dst, Bit2_T a, Bit2_T b);
+extern void Bit2ops_or(Bit2_T dst, Bit2_T a, Bit2_T b);
+extern void Bit2ops_xor(Bit2_T dst, Bit2_T a, Bit2_T b);
+extern void Bit2ops_not(Bit2_T dst, Bit2_T src);
+
+extern void Bit2ops_shiftLeft(Bit2_T dst, Bit2_T src);
+extern void Bit2ops_shiftRight(Bit2_T dst, Bit2_T src);
+extern void Bit2ops_shiftUp(Bit2_T dst, Bit2_T src);
+extern void Bit2ops_shiftDown(Bit2_T dst, Bit2_T src);
+
+extern void Bit2ops_dilate(Bit2_T dst, Bit2_T src, int connectivity);
+extern void Bit2ops_erode(Bit2_T dst, Bit2_T src, int connectivity);
+
+extern uint64_t Bit2ops_count(Bit2_T bitmap);
+
+extern void Bit2ops_reconstruct(Bit2_T marker, Bit2_T mask,
+                                int connectivity);
+extern void Bit2ops_removeBorder(Bit2_T bitmap, int connectivity);
+
+#endif
@@ -0,0 +1,166 @@
+/* bit2opsTests.c
+ *
+ * By: Drew Maynard and Joel Brandinger, 02/08/22
+ * Interfaces, Implementations, and Images (iii)
+ *
+ * This file tests the bit2ops module against the same operations done one
+ * pixel at a time, on random bitmaps of widths around the word boundaries.
+ *
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "bit2ops.h"
+#include "bit2testutil.h"
+
+static Bit2_T copy(Bit2_T bitmap);
+static int pixel(Bit2_T bitmap, int col, int row);
+static Bit2_T slowNeighborhood(Bit2_T src, int connectivity, bool dilate);
+static Bit2_T slowReconstruct(Bit2_T marker, Bit2_T mask, int connectivity);
+
+int main(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    startTests();
+
+    for (int i = 0; i < NUM_TEST_WIDTHS; i++) {
+        for (int j = 0; j < NUM_TEST_HEIGHTS; j++) {
+            int width = testWidths[i];
+            int height = testHeights[j];
+            Bit2_T a = randomBitmap(width, height, 50);
+            Bit2_T b = randomBitmap(width, height, 50);
+            Bit2_T dense = randomBitmap(width, height, 85);
+            Bit2_T out = Bit2_new(width, height);
+            Bit2_T expected = Bit2_new(width, height);
+            uint64_t count = 0;
+
+            for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col++) {
+                    Bit2_put(expected, col, row,
+                             Bit2_get(a, col, row) & Bit2_get(b, col, row));
+                    count += Bit2_get(a, col, row);
+                }
+            }
+            Bit2ops_and(out, a, b);
+            check(same(out, expected), "and", width, height);
+            check(Bit2ops_count(a) == count, "count", width, height);
+
+            Bit2ops_not(out, a);
+            Bit2ops_not(out, out);
+            check(same(out, a), "not", width, height);
+            Bit2ops_xor(out, a, b);
+            Bit2ops_or(expected, a, b);
+            Bit2ops_xor(expected, expected, out);
+            Bit2ops_and(out, a, b);
+            check(same(out, expected), "or/xor", width, height);
+
+            for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col++) {
+                    Bit2_put(expected, col, row, pixel(a, col + 1, row));
+                }
+            }
+            Bit2ops_shiftLeft(out, a);
+            check(same(out, expected), "shiftLeft", width, height);
+            Bit2ops_shiftRight(out, out);
+            Bit2ops_shiftLeft(out, out);
+            check(same(out, expected), "shiftRight", width, height);
+            for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col++) {
+                    Bit2_put(expected, col, row, pixel(a, col, row + 1));
+                }
+            }
+            Bit2ops_shiftUp(out, a);
+            check(same(out, expected), "shiftUp", width, height);
+            Bit2ops_shiftDown(out, out);
+            Bit2ops_shiftUp(out, out);
+            check(same(out, expected), "shiftDown", width, height);
+
+            for (int connectivity = 4; connectivity <= 8; connectivity += 4) {
+                Bit2_T slow = slowNeighborhood(a, connectivity, true);
+                Bit2ops_dilate(out, a, connectivity);
+                check(same(out, slow), "dilate", width, height);
+                Bit2_free(&slow);
+
+                slow = slowNeighborhood(dense, connectivity, false);
+                Bit2_T inPlace = copy(dense);
+                Bit2ops_erode(inPlace, inPlace, connectivity);
+                check(same(inPlace, slow), "erode", width, height);
+                Bit2_free(&slow);
+                Bit2_free(&inPlace);
+
+                Bit2_T marker = randomBitmap(width, height, 2);
+                slow = slowReconstruct(marker, a, connectivity);
+                Bit2ops_reconstruct(marker, a, connectivity);
+                check(same(marker, slow), "reconstruct", width, height);
+                Bit2_free(&slow);
+                Bit2_free(&marker);
+            }
+
+            Bit2_free(&a);
+            Bit2_free(&b);
+            Bit2_free(&dense);
+            Bit2_free(&out);
+            Bit2_free(&expected);
+        }
+    }
+
+    return finishTests("bit2ops");
+}
+
+static Bit2_T copy(Bit2_T bitmap)
+{
+    Bit2_T result = Bit2_new(Bit2_width(bitmap), Bit2_height(bitmap));
+    Bit2ops_or(result, bitmap, bitmap);
+    return result;
+}
+
+/* A pixel, or white outside the image */
+static int pixel(Bit2_T bitmap, int col, int row)
+{
+    if (col < 0 || row < 0 || col >= Bit2_width(bitmap) ||
+        row >= Bit2_height(bitmap)) {
+        return 0;
+    }
+    return Bit2_get(bitmap, col, row);
+}
+
+static Bit2_T slowNeighborhood(Bit2_T src, int connectivity, bool dilate)
+{
+    Bit2_T result = Bit2_new(Bit2_width(src), Bit2_height(src));
+    for (int row = 0; row < Bit2_height(src); row++) {
+        for (int col = 0; col < Bit2_width(src); col++) {
+            int bit = pixel(src, col, row);
+            for (int dr = -1; dr <= 1; dr++) {
+                for (int dc = -1; dc <= 1; dc++) {
+                    if (connectivity == 4 && dr != 0 && dc != 0) {
+                        continue;
+                    }
+                    int near = pixel(src, col + dc, row + dr);
+                    bit = dilate ? (bit | near) : (bit & near);
+                }
+            }
+            Bit2_put(result, col, row, bit);
+        }
+    }
+    return result;
+}
+
+static Bit2_T slowReconstruct(Bit2_T marker, Bit2_T mask, int connectivity)
+{
+    Bit2_T result = copy(marker);
+    Bit2ops_and(result, result, mask);
+    for (;;) {
+        Bit2_T grown = slowNeighborhood(result, connectivity, true);
+        Bit2ops_and(grown, grown, mask);
+        bool done = same(grown, result);
+        Bit2_free(&result);
+        result = grown;
+        if (done) {
+            return result;
+        }
+    }
+}
@@ -0,0 +1,571 @@
+/* bit2rle.c
+ *
+ * By: Drew Maynard and Joel Brandinger, 02/08/22
+ * Interfaces, Implementations, and Images (iii)
+ *
+ * This file contains the implementation for the run-length bit2 data
+ * structure.
+ *
+ * NOTE: Each row has its own array of runs, sorted by column, that doubles
+ *       when it fills up; a white row has none allocated. A pixel is found
+ *       with a binary search for the first run that ends past it, and put
+ *       grows, shrinks, splits, joins, adds or deletes that one run.
+ *
+ *       removeBorder marks every run on the border of the image, then
+ *       keeps taking a marked run off a stack and marking the runs of the
+ *       rows above and below that touch it. The marks are one byte per
+ *       run, and the marked runs are deleted at the end.
+ *
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "bit2rle.h"
+#include "bit2span.h"
+#include "stack.h"
+
+#define T Bit2rle_T
+#define WORD_BITS 64
+
+struct Row {
+    Bit2span_run *runs;
+    int length;
+    int capacity;
+};
+
+struct T {
+    int width;
+    int height;
+    struct Row *rows;
+};
+
+/* The runs still to be filled from, each packed into one word as
+ * (row << 32) | index */
+STACK_DECLARE(RunStack, uint64_t)
+
+/* The state of removeBorder: where each row's marks start, the marks, and
+ * the runs that are marked but not yet filled from */
+struct Fill {
+    size_t *offset;
+    uint8_t *marked;
+    struct RunStack stack;
+};
+
+static int search(const struct Row *row, int col);
+static void insertRun(struct Row *row, int i, int start, int end);
+static void deleteRun(struct Row *row, int i);
+static void markRun(struct Fill *fill, int row, int i);
+
+/* Bit2rle_new
+ *
+ *      Purpose: Allocate a new run-length 2D array of bits, all white.
+ *
+ *   Parameters: The width (columns) and height (rows).
+ *
+ *      Returns: The new array, which the caller frees.
+ *
+ * Expectations: width and height are not negative.
+ *
+*/
+extern T Bit2rle_new(int width, int height)
+{
+    assert(width >= 0);
+    assert(height >= 0);
+    T bit2 = malloc(sizeof(struct T));
+    assert(bit2 != NULL);
+    bit2->width = width;
+    bit2->height = height;
+    /* calloc(0) may return NULL, so an empty image still gets a row */
+    bit2->rows = calloc(height > 0 ? height : 1, sizeof(struct Row));
+    assert(bit2->rows != NULL);
+    return bit2;
+}
+
+/* Bit2rle_free
+ *
+ *      Purpose: Free the array and the runs of every row.
+ *
+ *   Parameters: A reference to the array, which is set to NULL.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The array is not null.
+ *
+*/
+extern void Bit2rle_free(T *bit2)
+{
+    assert(bit2 != NULL && *bit2 != NULL);
+    for (int j = 0; j < (*bit2)->height; j++) {
+        free((*bit2)->rows[j].runs);
+    }
+    free((*bit2)->rows);
+    free(*bit2);
+    *bit2 = NULL;
+}
+
+/* Bit2rle_width
+ *
+ *      Purpose: Get the width of the array.
+ *
+ *   Parameters: The array.
+ *
+ *      Returns: The number of columns.
+ *
+ * Expectations: The array is not null.
+ *
+*/
+extern int Bit2rle_width(T bit2)
+{
+    assert(bit2);
+    return bit2->width;
+}
+
+/* Bit2rle_height
+ *
+ *      Purpose: Get the height of the array.
+ *
+ *   Parameters: The array.
+ *
+ *      Returns: The number of rows.
+ *
+ * Expectations: The array is not null.
+ *
+*/
+extern int Bit2rle_height(T bit2)
+{
+    assert(bit2);
+    return bit2->height;
+}
+
+/* Bit2rle_runs
+ *
+ *      Purpose: Count the black runs of the whole array, which is what its
+ *               memory grows with.
+ *
+ *   Parameters: The array.
+ *
+ *      Returns: The number of runs.
+ *
+ * Expectations: The array is not null.
+ *
+*/
+extern size_t Bit2rle_runs(T bit2)
+{
+    assert(bit2);
+    size_t count = 0;
+    for (int j = 0; j < bit2->height; j++) {
+        count += bit2->rows[j].length;
+    }
+    return count;
+}
+
+/* Bit2rle_get
+ *
+ *      Purpose: Get the value of a pixel.
+ *
+ *   Parameters: The array, the column and the row.
+ *
+ *      Returns: 1 if the pixel is in a black run, 0 if not.
+ *
+ * Expectations: The column and row are in bounds.
+ *
+*/
+extern int Bit2rle_get(T bit2, int col, int row)
+{
+    assert(bit2);
+    assert(col >= 0 && col < bit2->width);
+    assert(row >= 0 && row < bit2->height);
+    const struct Row *runs = &bit2->rows[row];
+    int i = search(runs, col);
+    return i < runs->length && runs->runs[i].start <= col;
+}
+
+/* Bit2rle_put
+ *
+ *      Purpose: Set the value of a pixel. Making a pixel black grows the
+ *               run next to it, joins the two runs it was between, or adds
+ *               a run of its own; making one white shrinks, splits or
+ *               deletes its run.
+ *
+ *   Parameters: The array, the column, the row and the bit.
+ *
+ *      Returns: The previous value of the pixel.
+ *
+ * Expectations: The column and row are in bounds, the bit is 0 or 1.
+ *
+*/
+extern int Bit2rle_put(T bit2, int col, int row, int bit)
+{
+    assert(bit2);
+    assert(col >= 0 && col < bit2->width);
+    assert(row >= 0 && row < bit2->height);
+    assert(bit == 0 || bit == 1);
+    struct Row *runs = &bit2->rows[row];
+    int i = search(runs, col);
+
+    if (i < runs->length && runs->runs[i].start <= col) {
+        Bit2span_run *run = &runs->runs[i];
+        if (bit == 1) {
+            return 1;
+        }
+        if (run->start == col && run->end == col + 1) {
+            deleteRun(runs, i);
+        } else if (run->start == col) {
+            run->start++;
+        } else if (run->end == col + 1) {
+            run->end--;
+        } else {
+            int end = run->end;
+            run->end = col;
+            insertRun(runs, i + 1, col + 1, end);
+        }
+        return 1;
+    }
+
+    if (bit == 0) {
+        return 0;
+    }
+    bool joinsLeft = i > 0 && runs->runs[i - 1].end == col;
+    bool joinsRight = i < runs->length && runs->runs[i].start == col + 1;
+    if (joinsLeft && joinsRight) {
+        runs->runs[i - 1].end = runs->runs[i].end;
+        deleteRun(runs, i);
+    } else if (joinsLeft) {
+        runs->runs[i - 1].end++;
+    } else if (joinsRight) {
+        runs->runs[i].start--;
+    } else {
+        insertRun(runs, i, col, col + 1);
+    }
+    return 0;
+}
+
+/* Bit2rle_getRow
+ *
+ *      Purpose: Write a row out as the packed words of a Bit2_T row, the
+ *               leftmost pixel of each word in its least significant bit.
+ *
+ *   Parameters: The array, the row, and room for its words.
+ *
+ *      Returns: None.
+ *
+ * Expectations: words has (width + 63) / 64 words.
+ *
+*/
+extern void Bit2rle_getRow(T bit2, int row, uint64_t *words)
+{
+    assert(bit2);
+    assert(row >= 0 && row < bit2->height);
+    assert(words != NULL || bit2->width == 0);
+    const struct Row *runs = &bit2->rows[row];
+    int numWords = (bit2->width + WORD_BITS - 1) / WORD_BITS;
+    if (numWords > 0) {
+        memset(words, 0, numWords * sizeof(uint64_t));
+    }
+    for (int i = 0; i < runs->length; i++) {
+        Bit2span_set(words, runs->runs[i].start, runs->runs[i].end);
+    }
+}
+
+/* Bit2rle_putRow
+ *
+ *      Purpose: Replace a row with the runs of the packed words of a
+ *               Bit2_T row, found with the span search of bit2span.c.
+ *
+ *   Parameters: The array, the row, and its words.
+ *
+ *      Returns: None.
+ *
+ * Expectations: words has (width + 63) / 64 words, and the bits past the
+ *               end of the row are 0.
+ *
+*/
+extern void Bit2rle_putRow(T bit2, int row, const uint64_t *words)
+{
+    assert(bit2);
+    assert(row >= 0 && row < bit2->height);
+    assert(words != NULL || bit2->width == 0);
+    struct Row *runs = &bit2->rows[row];
+    int numWords = (bit2->width + WORD_BITS - 1) / WORD_BITS;
+
+    runs->length = 0;
+    int col = Bit2span_next(words, numWords, 0);
+    while (col < bit2->width) {
+        int end = Bit2span_end(words, numWords, col);
+        insertRun(runs, runs->length, col, end);
+        col = Bit2span_next(words, numWords, end);
+    }
+}
+
+/* Bit2rle_fromBit2
+ *
+ *      Purpose: Make a run-length copy of a bitmap, a row at a time.
+ *
+ *   Parameters: The bitmap.
+ *
+ *      Returns: The new array, which the caller frees.
+ *
+ * Expectations: The bitmap is not null.
+ *
+*/
+extern T Bit2rle_fromBit2(Bit2_T bitmap)
+{
+    assert(bitmap);
+    T bit2 = Bit2rle_new(Bit2_width(bitmap), Bit2_height(bitmap));
+    for (int j = 0; j < bit2->height; j++) {
+        Bit2rle_putRow(bit2, j, Bit2_row(bitmap, j));
+    }
+    return bit2;
+}
+
+/* Bit2rle_toBit2
+ *
+ *      Purpose: Make a packed copy of the array, a row at a time.
+ *
+ *   Parameters: The array.
+ *
+ *      Returns: The new bitmap, which the caller frees.
+ *
+ * Expectations: The array is not null.
+ *
+*/
+extern Bit2_T Bit2rle_toBit2(T bit2)
+{
+    assert(bit2);
+    Bit2_T bitmap = Bit2_new(bit2->width, bit2->height);
+    for (int j = 0; j < bit2->height; j++) {
+        Bit2rle_getRow(bit2, j, Bit2_row(bitmap, j));
+    }
+    return bitmap;
+}
+
+/* Bit2rle_map_row_major
+ *
+ *      Purpose: Traverse each element of the array in row major order,
+ *               walking the runs of each row alongside the columns instead
+ *               of searching for each pixel.
+ *
+ *   Parameters: The array, the function to be applied to each element,
+ *               the folding variable if needed.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The array is not null. Apply does not change the array.
+ *
+*/
+extern void Bit2rle_map_row_major(T bit2, void (apply(int i, int j, T bit2,
+    int bit, void *cl)), void *cl)
+{
+    assert(bit2);
+    for (int j = 0; j < bit2->height; j++) {
+        const struct Row *runs = &bit2->rows[j];
+        int k = 0;
+        for (int i = 0; i < bit2->width; i++) {
+            if (k < runs->length && runs->runs[k].end <= i) {
+                k++;
+            }
+            int bit = k < runs->length && runs->runs[k].start <= i;
+            apply(i, j, bit2, bit, cl);
+        }
+    }
+}
+
+/* Bit2rle_map_runs
+ *
+ *      Purpose: Traverse the black runs of the array in row major order.
+ *
+ *   Parameters: The array, the function to be applied to each run (given
+ *               its first column, the column just past it, and the row),
+ *               the folding variable if needed.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The array is not null. Apply does not change the array.
+ *
+*/
+extern void Bit2rle_map_runs(T bit2, void (apply(int start, int end, int j,
+    T bit2, void *cl)), void *cl)
+{
+    assert(bit2);
+    for (int j = 0; j < bit2->height; j++) {
+        const struct Row *runs = &bit2->rows[j];
+        for (int k = 0; k < runs->length; k++) {
+            apply(runs->runs[k].start, runs->runs[k].end, j, bit2, cl);
+        }
+    }
+}
+
+/* Bit2rle_removeBorder
+ *
+ *      Purpose: Make white every black pixel connected to the border of
+ *               the image, by filling over the runs from the runs on the
+ *               border. Two runs of neighboring rows touch if they share a
+ *               column, or with 8-connectivity also a corner.
+ *
+ *   Parameters: The array and the connectivity (4 or 8).
+ *
+ *      Returns: None.
+ *
+ * Expectations: The array is not null.
+ *
+*/
+extern void Bit2rle_removeBorder(T bit2, int connectivity)
+{
+    assert(bit2);
+    assert(connectivity == 4 || connectivity == 8);
+    int reach = connectivity == 8 ? 1 : 0;
+    struct Fill fill = { NULL, NULL, { NULL, 0, 0 } };
+
+    fill.offset = malloc(((size_t)bit2->height + 1) * sizeof(size_t));
+    assert(fill.offset != NULL);
+    fill.offset[0] = 0;
+    for (int j = 0; j < bit2->height; j++) {
+        fill.offset[j + 1] = fill.offset[j] + bit2->rows[j].length;
+    }
+    size_t numRuns = fill.offset[bit2->height];
+    fill.marked = calloc(numRuns > 0 ? numRuns : 1, 1);
+    assert(fill.marked != NULL);
+
+    for (int j = 0; j < bit2->height; j++) {
+        const struct Row *runs = &bit2->rows[j];
+        for (int k = 0; k < runs->length; k++) {
+            const Bit2span_run *run = &runs->runs[k];
+            if (j == 0 || j == bit2->height - 1 || run->start == 0 ||
+                run->end == bit2->width) {
+                markRun(&fill, j, k);
+            }
+        }
+    }
+
+    while (fill.stack.length > 0) {
+        uint64_t at = RunStack_pop(&fill.stack);
+        int j = (int)(at >> 32);
+        Bit2span_run run = bit2->rows[j].runs[(uint32_t)at];
+        for (int next = j - 1; next <= j + 1; next += 2) {
+            if (next < 0 || next >= bit2->height) {
+                continue;
+            }
+            const struct Row *runs = &bit2->rows[next];
+            for (int k = search(runs, run.start - reach);
+                 k < runs->length && runs->runs[k].start < run.end + reach;
+                 k++) {
+                markRun(&fill, next, k);
+            }
+        }
+    }
+
+    for (int j = 0; j < bit2->height; j++) {
+        struct Row *runs = &bit2->rows[j];
+        const uint8_t *marked = &fill.marked[fill.offset[j]];
+        int kept = 0;
+        for (int k = 0; k < runs->length; k++) {
+            if (!marked[k]) {
+                runs->runs[kept++] = runs->runs[k];
+            }
+        }
+        runs->length = kept;
+        if (kept == 0) {
+            free(runs->runs);
+            runs->runs = NULL;
+            runs->capacity = 0;
+        }
+    }
+
+    RunStack_free(&fill.stack);
+    free(fill.marked);
+    free(fill.offset);
+}
+
+/* search
+ *
+ *      Purpose: Binary search a row for the first run that ends past a
+ *               column, which is the run holding the column if any is.
+ *
+ *   Parameters: The row and the column.
+ *
+ *      Returns: The index of the run, or the number of runs if none ends
+ *               past the column.
+ *
+ * Expectations: None.
+ *
+*/
+static int search(const struct Row *row, int col)
+{
+    int low = 0;
+    int high = row->length;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (row->runs[middle].end > col) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+    return low;
+}
+
+/* insertRun
+ *
+ *      Purpose: Insert a run into a row, doubling its array when it is
+ *               full.
+ *
+ *   Parameters: The row, the index the run goes at, and the run.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The run keeps the row sorted and apart.
+ *
+*/
+static void insertRun(struct Row *row, int i, int start, int end)
+{
+    if (row->length == row->capacity) {
+        row->capacity = row->capacity > 0 ? 2 * row->capacity : 4;
+        row->runs = realloc(row->runs, row->capacity * sizeof(Bit2span_run));
+        assert(row->runs != NULL);
+    }
+    memmove(&row->runs[i + 1], &row->runs[i],
+            (row->length - i) * sizeof(Bit2span_run));
+    row->runs[i].start = start;
+    row->runs[i].end = end;
+    row->length++;
+}
+
+/* deleteRun
+ *
+ *      Purpose: Delete a run from a row.
+ *
+ *   Parameters: The row and the index of the run.
+ *
+ *      Returns: None.
+ *
+ * Expectations: 0 <= i < length.
+ *
+*/
+static void deleteRun(struct Row *row, int i)
+{
+    memmove(&row->runs[i], &row->runs[i + 1],
+            (row->length - i - 1) * sizeof(Bit2span_run));
+    row->length--;
+}
+
+/* markRun
+ *
+ *      Purpose: Mark a run to be removed and push it to be filled from,
+ *               unless it is already marked.
+ *
+ *   Parameters: The fill, the row and the index of the run.
+ *
+ *      Returns: None.
+ *
+ * Expectations: None.
+ *
+*/
+static void markRun(struct Fill *fill, int row, int i)
+{
+    uint8_t *mark = &fill->marked[fill->offset[row] + i];
+    if (!*mark) {
+        *mark = 1;
+        RunStack_push(&fill->stack, (uint64_t)row << 32 | (uint32_t)i);
+    }
+}
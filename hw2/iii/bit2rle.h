@@ -0,0 +1,54 @@
+/* bit2rle.h
+ *
+ * By: Drew Maynard and Joel Brandinger, 02/08/22
+ * Interfaces, Implementations, and Images (iii)
+ *
+ * This file contains the interface for the run-length bit2 data structure.
+ *
+ * A Bit2rle_T holds the same 2D array of bits as a Bit2_T, but each row is
+ * kept as a sorted list of its black runs instead of a word per 64
+ * pixels, so a mostly white image (a scanned page) takes memory for its
+ * black runs and almost none for its white. Runs are half open, columns
+ * start up to (not including) end, and never touch or overlap.
+ *
+ * Rows are converted to and from the packed words of a Bit2_T row, so
+ * whole images can move between the two, and removeBorder clears the
+ * black connected to the border of the image with a fill over the runs.
+ *
+*/
+
+#ifndef BIT2RLE_INCLUDED
+#define BIT2RLE_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+#include "bit2.h"
+
+#define T Bit2rle_T
+typedef struct T *T;
+
+extern T Bit2rle_new(int width, int height);
+extern void Bit2rle_free(T *bit2);
+
+extern int Bit2rle_width(T bit2);
+extern int Bit2rle_height(T bit2);
+extern size_t Bit2rle_runs(T bit2);
+
+extern int Bit2rle_get(T bit2, int col, int row);
+extern int Bit2rle_put(T bit2, int col, int row, int bit);
+
+extern void Bit2rle_getRow(T bit2, int row, uint64_t *words);
+extern void Bit2rle_putRow(T bit2, int row, const uint64_t *words);
+
+extern T Bit2rle_fromBit2(Bit2_T bitmap);
+extern Bit2_T Bit2rle_toBit2(T bit2);
+
+extern void Bit2rle_map_row_major(T bit2, void (apply(int i, int j, T bit2,
+    int bit, void *cl)), void *cl);
+extern void Bit2rle_map_runs(T bit2, void (apply(int start, int end, int j,
+    T bit2, void *cl)), void *cl);
+
+extern void Bit2rle_removeBorder(T bit2, int connectivity);
+
+#undef T
+#endif
@@ -0,0 +1,108 @@
+/* bit2rleTests.c
+ *
+ * By: Drew Maynard and Joel Brandinger, 02/08/22
+ * Interfaces, Implementations, and Images (iii)
+ *
+ * This file tests the bit2rle module against a Bit2_T given the same puts,
+ * and its border removal against Bit2ops_removeBorder, on random bitmaps
+ * of widths around the word boundaries.
+ *
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "bit2rle.h"
+#include "bit2ops.h"
+#include "bit2testutil.h"
+
+static void checkPixel(int col, int row, Bit2rle_T bit2, int bit,
+                       void *cl);
+static void copyRun(int start, int end, int row, Bit2rle_T bit2, void *cl);
+
+int main(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    const int percents[] = { 5, 50, 90 };
+    startTests();
+
+    for (int i = 0; i < NUM_TEST_WIDTHS; i++) {
+    for (int j = 0; j < NUM_TEST_HEIGHTS; j++) {
+    for (size_t k = 0; k < sizeof(percents) / sizeof(percents[0]); k++) {
+        int width = testWidths[i];
+        int height = testHeights[j];
+
+        /* Random puts, mostly black or mostly white */
+        Bit2_T dense = Bit2_new(width, height);
+        Bit2rle_T runs = Bit2rle_new(width, height);
+        bool puts = true;
+        for (int n = 0; n < 4 * width * height; n++) {
+            int col = rand() % width;
+            int row = rand() % height;
+            int bit = rand() % 100 < percents[k];
+            puts &= Bit2rle_put(runs, col, row, bit) ==
+                    Bit2_put(dense, col, row, bit);
+        }
+        check(puts, "put", width, height);
+
+        bool gets = true;
+        for (int row = 0; row < height; row++) {
+            for (int col = 0; col < width; col++) {
+                gets &= Bit2rle_get(runs, col, row) ==
+                        Bit2_get(dense, col, row);
+            }
+        }
+        check(gets, "get", width, height);
+
+        Bit2_T back = Bit2rle_toBit2(runs);
+        check(same(back, dense), "toBit2", width, height);
+        Bit2_free(&back);
+
+        Bit2_T copy = Bit2_new(width, height);
+        Bit2rle_map_runs(runs, copyRun, copy);
+        check(same(copy, dense), "map_runs", width, height);
+        Bit2_free(&copy);
+
+        bool mapped = true;
+        Bit2rle_map_row_major(runs, checkPixel, &mapped);
+        check(mapped, "map_row_major", width, height);
+        Bit2rle_free(&runs);
+        Bit2_free(&dense);
+
+        for (int connectivity = 4; connectivity <= 8; connectivity += 4) {
+            Bit2_T bitmap = randomBitmap(width, height, percents[k]);
+            runs = Bit2rle_fromBit2(bitmap);
+            back = Bit2rle_toBit2(runs);
+            check(same(back, bitmap), "fromBit2", width, height);
+            Bit2_free(&back);
+
+            Bit2rle_removeBorder(runs, connectivity);
+            Bit2ops_removeBorder(bitmap, connectivity);
+            back = Bit2rle_toBit2(runs);
+            check(same(back, bitmap), "removeBorder", width, height);
+            Bit2_free(&back);
+            Bit2rle_free(&runs);
+            Bit2_free(&bitmap);
+        }
+    }
+    }
+    }
+
+    return finishTests("bit2rle");
+}
+
+static void checkPixel(int col, int row, Bit2rle_T bit2, int bit, void *cl)
+{
+    *(bool *)cl &= Bit2rle_get(bit2, col, row) == bit;
+}
+
+static void copyRun(int start, int end, int row, Bit2rle_T bit2, void *cl)
+{
+    (void)bit2;
+    for (int col = start; col < end; col++) {
+        Bit2_put(cl, col, row, 1);
+    }
+}
@@ -0,0 +1,222 @@
+/* bit2span.c
+ *
+ * By: Drew Maynard and Joel Brandinger, 02/08/22
+ * Interfaces, Implementations, and Images (iii)
+ *
+ * This file contains the implementation for working with the black runs
+ * of the packed rows of a Bit2_T.
+ *
+ * NOTE: The searches skip whole words that have nothing to find and
+ *       find the bit they stop on with a count of leading or trailing
+ *       zeros. The bits past the end of a row are 0, so a search to the
+ *       right stops in the row's last word unless the row fills it.
+ *
+*/
+
+#include "bit2span.h"
+
+/* Bit2span_start
+ *
+ *      Purpose: Find where the black run through a pixel begins, by looking
+ *               for the nearest white bit to its left a word at a time.
+ *
+ *   Parameters: The words of the row and the column of a black pixel.
+ *
+ *      Returns: The column of the first pixel of the run.
+ *
+ * Expectations: None.
+ *
+*/
+extern int Bit2span_start(const uint64_t *words, int col)
+{
+    int w = col / 64;
+    uint64_t below = ((uint64_t)1 << (col % 64)) - 1;
+    uint64_t white = ~words[w] & below;
+
+    while (white == 0) {
+        if (w == 0) {
+            return 0;
+        }
+        white = ~words[--w];
+    }
+    return 64 * w + 64 - __builtin_clzll(white);
+}
+
+/* Bit2span_end
+ *
+ *      Purpose: Find where the black run through a pixel ends, by looking
+ *               for the nearest white bit to its right a word at a time.
+ *
+ *   Parameters: The words of the row, how many there are, and the column
+ *               of a black pixel.
+ *
+ *      Returns: The column just past the last pixel of the run.
+ *
+ * Expectations: None.
+ *
+*/
+extern int Bit2span_end(const uint64_t *words, int numWords, int col)
+{
+    int w = col / 64;
+    uint64_t white = ~words[w] & (~(uint64_t)0 << (col % 64));
+
+    while (white == 0) {
+        if (++w == numWords) {
+            return 64 * numWords;
+        }
+        white = ~words[w];
+    }
+    return 64 * w + __builtin_ctzll(white);
+}
+
+/* Bit2span_next
+ *
+ *      Purpose: Find the first black pixel of a row at or after a column,
+ *               skipping white words whole. With Bit2span_end, this lists
+ *               the runs of a row in order.
+ *
+ *   Parameters: The words of the row, how many there are, and the column.
+ *
+ *      Returns: The column of the pixel, or 64 * numWords if there is none.
+ *
+ * Expectations: None.
+ *
+*/
+extern int Bit2span_next(const uint64_t *words, int numWords, int col)
+{
+    int w = col / 64;
+    if (w >= numWords) {
+        return 64 * numWords;
+    }
+
+    uint64_t bits = words[w] & (~(uint64_t)0 << (col % 64));
+    while (bits == 0) {
+        if (++w == numWords) {
+            return 64 * numWords;
+        }
+        bits = words[w];
+    }
+    return 64 * w + __builtin_ctzll(bits);
+}
+
+/* Bit2span_mask
+ *
+ *      Purpose: Get the bits of one word of a row that lie in a run of
+ *               columns.
+ *
+ *   Parameters: The index of the word, the first column of the run and the
+ *               column just past it.
+ *
+ *      Returns: The mask.
+ *
+ * Expectations: The word overlaps the run.
+ *
+*/
+extern uint64_t Bit2span_mask(int word, int start, int end)
+{
+    uint64_t mask = ~(uint64_t)0;
+    if (word == start / 64) {
+        mask &= ~(uint64_t)0 << (start % 64);
+    }
+    if (word == (end - 1) / 64) {
+        mask &= ~(uint64_t)0 >> (63 - (end - 1) % 64);
+    }
+    return mask;
+}
+
+/* Bit2span_clear
+ *
+ *      Purpose: Make a run of pixels white, a word at a time.
+ *
+ *   Parameters: The words of the row, the first column of the run and the
+ *               column just past it.
+ *
+ *      Returns: None.
+ *
+ * Expectations: start < end.
+ *
+*/
+extern void Bit2span_clear(uint64_t *words, int start, int end)
+{
+    for (int w = start / 64; w <= (end - 1) / 64; w++) {
+        words[w] &= ~Bit2span_mask(w, start, end);
+    }
+}
+
+/* Bit2span_set
+ *
+ *      Purpose: Make a run of pixels black, a word at a time.
+ *
+ *   Parameters: The words of the row, the first column of the run and the
+ *               column just past it.
+ *
+ *      Returns: None.
+ *
+ * Expectations: start < end.
+ *
+*/
+extern void Bit2span_set(uint64_t *words, int start, int end)
+{
+    for (int w = start / 64; w <= (end - 1) / 64; w++) {
+        words[w] |= Bit2span_mask(w, start, end);
+    }
+}
+
+/* Bit2span_map_overlaps
+ *
+ *      Purpose: Call a function on every pair of runs of two neighboring
+ *               rows that touch. Both lists are sorted, so one pass that
+ *               always steps past the run that ends first finds every
+ *               pair.
+ *
+ *   Parameters: The runs of the upper row and how many there are, the
+ *               runs of the lower row and how many there are, how far
+ *               apart runs can be and still touch (1 for corner
+ *               neighbors, 0 if not), the function, which gets the index
+ *               of the upper and of the lower run, and a closure for it.
+ *
+ *      Returns: None.
+ *
+ * Expectations: Each list is sorted and its runs do not overlap.
+ *
+*/
+extern void Bit2span_map_overlaps(const Bit2span_run *upper,
+    uint32_t numUpper, const Bit2span_run *lower, uint32_t numLower,
+    int reach, void (apply(uint32_t i, uint32_t j, void *cl)), void *cl)
+{
+    uint32_t i = 0;
+    uint32_t j = 0;
+
+    while (i < numUpper && j < numLower) {
+        if (upper[i].end + reach > lower[j].start &&
+            lower[j].end + reach > upper[i].start) {
+            apply(i, j, cl);
+        }
+        if (upper[i].end < lower[j].end) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+}
+
+/* Bit2span_find
+ *
+ *      Purpose: Find the root of a node of a union-find, halving the path
+ *               on the way.
+ *
+ *   Parameters: The parent of every node and the node.
+ *
+ *      Returns: The root.
+ *
+ * Expectations: Only one thread uses the union-find at a time.
+ *
+*/
+extern uint32_t Bit2span_find(uint32_t *parent, uint32_t x)
+{
+    while (parent[x] != x) {
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+}
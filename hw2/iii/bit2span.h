@@ -0,0 +1,42 @@
+/* bit2span.h
+ *
+ * By: Drew Maynard and Joel Brandinger, 02/08/22
+ * Interfaces, Implementations, and Images (iii)
+ *
+ * This file contains the interface for working with the black runs
+ * (spans) of the packed rows of a Bit2_T. Runs are half open, columns
+ * start up to (not including) end.
+ *
+ * A row is searched, cleared and masked a word at a time, so the cost is
+ * per run and per 64 pixels rather than per pixel. The runs of two
+ * neighboring rows are matched in one pass over their sorted lists, and
+ * the labelers that join matched runs share one union-find find.
+ *
+*/
+
+#ifndef BIT2SPAN_INCLUDED
+#define BIT2SPAN_INCLUDED
+
+#include <stdint.h>
+#include "bit2.h"
+
+/* A black run of a row: columns start up to (not including) end */
+typedef struct Bit2span_run {
+    int start;
+    int end;
+} Bit2span_run;
+
+extern int Bit2span_start(const uint64_t *words, int col);
+extern int Bit2span_end(const uint64_t *words, int numWords, int col);
+extern int Bit2span_next(const uint64_t *words, int numWords, int col);
+
+extern uint64_t Bit2span_mask(int word, int start, int end);
+extern void Bit2span_clear(uint64_t *words, int start, int end);
+extern void Bit2span_set(uint64_t *words, int start, int end);
+
+extern void Bit2span_map_overlaps(const Bit2span_run *upper,
+    uint32_t numUpper, const Bit2span_run *lower, uint32_t numLower,
+    int reach, void (apply(uint32_t i, uint32_t j, void *cl)), void *cl);
+extern uint32_t Bit2span_find(uint32_t *parent, uint32_t x);
+
+#endif
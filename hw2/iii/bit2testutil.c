@@ -0,0 +1,98 @@
+/* bit2testutil.c
+ *
+ * By: Drew Maynard and Joel Brandinger, 02/08/22
+ * Interfaces, Implementations, and Images (iii)
+ *
+ * This file contains the implementation for the helpers shared by the
+ * bitmap test programs.
+ *
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "bit2testutil.h"
+
+const int testWidths[NUM_TEST_WIDTHS] = { 1, 2, 63, 64, 65, 127, 130, 200 };
+const int testHeights[NUM_TEST_HEIGHTS] = { 1, 2, 3, 17, 40 };
+
+static int failures = 0;
+
+/* startTests
+ *
+ *      Purpose: Seed the random bitmaps, so every run tests the same ones
+ *   Parameters: None
+ *      Returns: None
+ *
+*/
+void startTests(void)
+{
+    srand(40);
+    failures = 0;
+}
+
+/* finishTests
+ *
+ *      Purpose: Say so if every check passed
+ *   Parameters: The name of what was tested
+ *      Returns: The exit status for main
+ *
+*/
+int finishTests(const char *name)
+{
+    if (failures == 0) {
+        printf("All %s tests passed\n", name);
+    }
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* randomBitmap
+ *
+ *      Purpose: Make a bitmap with each pixel black at random
+ *   Parameters: The width, the height, and the percent of black pixels
+ *      Returns: The bitmap, which the caller frees
+ *
+*/
+Bit2_T randomBitmap(int width, int height, int percent)
+{
+    Bit2_T bitmap = Bit2_new(width, height);
+    for (int row = 0; row < height; row++) {
+        for (int col = 0; col < width; col++) {
+            Bit2_put(bitmap, col, row, rand() % 100 < percent);
+        }
+    }
+    return bitmap;
+}
+
+/* same
+ *
+ *      Purpose: Compare two bitmaps of the same dimensions a word at a time
+ *   Parameters: The bitmaps
+ *      Returns: True if every pixel is the same
+ *
+*/
+bool same(Bit2_T a, Bit2_T b)
+{
+    for (int row = 0; row < Bit2_height(a); row++) {
+        for (int w = 0; w < Bit2_words(a); w++) {
+            if (Bit2_getword(a, w, row) != Bit2_getword(b, w, row)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/* check
+ *
+ *      Purpose: Report and count a failed check
+ *   Parameters: Whether it passed, its name, and the size it ran at
+ *      Returns: None
+ *
+*/
+void check(bool passed, const char *name, int width, int height)
+{
+    if (!passed) {
+        printf("%s failed on %dx%d\n", name, width, height);
+        failures++;
+    }
+}
@@ -0,0 +1,32 @@
+/* bit2testutil.h
+ *
+ * By: Drew Maynard and Joel Brandinger, 02/08/22
+ * Interfaces, Implementations, and Images (iii)
+ *
+ * This file contains the interface for the helpers shared by the bitmap
+ * test programs: the sizes every test runs at (widths around the word
+ * boundaries), random bitmaps, comparing bitmaps word by word, and
+ * counting failed checks.
+ *
+*/
+
+#ifndef BIT2TESTUTIL_INCLUDED
+#define BIT2TESTUTIL_INCLUDED
+
+#include <stdbool.h>
+#include "bit2.h"
+
+#define NUM_TEST_WIDTHS 8
+#define NUM_TEST_HEIGHTS 5
+
+extern const int testWidths[NUM_TEST_WIDTHS];
+extern const int testHeights[NUM_TEST_HEIGHTS];
+
+void startTests(void);
+int finishTests(const char *name);
+
+Bit2_T randomBitmap(int width, int height, int percent);
+bool same(Bit2_T a, Bit2_T b);
+void check(bool passed, const char *name, int width, int height);
+
+#endif
@@ -0,0 +1,383 @@
+/* components.c
+ *
+ * By: Drew Maynard and Joel Brandinger, 02/08/22
+ * Interfaces, Implementations, and Images (iii)
+ *
+ * This file contains the implementation for labeling connected components.
+ *
+ * NOTE: Labeling works on black runs, not pixels, in two passes. The
+ *       first finds the runs of each row with the span search of
+ *       bit2span.c, and joins each to the runs it touches in the row
+ *       above in a union-find whose roots are always the component's
+ *       first run. The second pass goes over the runs in order, numbering
+ *       each root as it is reached, so every other run finds its label
+ *       already set, and adds the run to its component's statistics.
+ *
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "components.h"
+#include "bit2span.h"
+
+#define T Components_T
+
+/* The runs of every row, where each row's runs start, and the label of
+ * each run */
+struct T {
+    int count;
+    int height;
+    Components_stats *stats;
+    Bit2span_run *runs;
+    uint32_t *rowStart;
+    uint32_t *labels;
+};
+
+/* The runs of the image so far, and the union-find joining them */
+struct Runs {
+    Bit2span_run *runs;
+    uint32_t *parent;
+    uint32_t length;
+    uint32_t capacity;
+};
+
+/* The union-find and the first runs of two neighboring rows, for
+ * linkRuns */
+struct Rows {
+    uint32_t *parent;
+    uint32_t upper;
+    uint32_t lower;
+};
+
+static void findRuns(struct Runs *runs, const uint64_t *words, int numWords,
+                     int width);
+static void addRun(struct Runs *runs, int start, int end);
+static void joinRows(struct Runs *runs, uint32_t i, uint32_t iEnd,
+                     uint32_t j, uint32_t jEnd, int reach);
+static void linkRuns(uint32_t i, uint32_t j, void *cl);
+static void addStats(Components_stats *stats, const Bit2span_run *run,
+                     int row);
+
+/* Components_label
+ *
+ *      Purpose: Find the connected components of the black pixels of a
+ *               bitmap.
+ *
+ *   Parameters: The bitmap, the connectivity (4 for edge neighbors, 8 for
+ *               edge and corner neighbors), and an array of uint32_t as
+ *               large as the bitmap to write each pixel's label into, or
+ *               NULL.
+ *
+ *      Returns: The components, which the caller frees.
+ *
+ * Expectations: The bitmap is not null, connectivity is 4 or 8, labels has
+ *               the bitmap's dimensions and elements of 4 bytes.
+ *
+*/
+extern T Components_label(Bit2_T bitmap, int connectivity,
+                          UArray2_T labels)
+{
+    assert(bitmap != NULL);
+    assert(connectivity == 4 || connectivity == 8);
+    int width = Bit2_width(bitmap);
+    int height = Bit2_height(bitmap);
+    int numWords = Bit2_words(bitmap);
+    if (labels != NULL) {
+        assert(UArray2_width(labels) == width);
+        assert(UArray2_height(labels) == height);
+        assert(UArray2_size(labels) == sizeof(uint32_t));
+    }
+
+    /* Runs overlap if they share a column, or also touch at a corner */
+    int reach = connectivity == 8 ? 1 : 0;
+    struct Runs runs = { NULL, NULL, 0, 0 };
+    uint32_t *rowStart = malloc((height + 1) * sizeof(uint32_t));
+    assert(rowStart != NULL);
+    uint32_t above = 0;
+    for (int row = 0; row < height; row++) {
+        uint32_t first = runs.length;
+        rowStart[row] = first;
+        findRuns(&runs, Bit2_row(bitmap, row), numWords, width);
+        joinRows(&runs, above, first, first, runs.length, reach);
+        above = first;
+    }
+    rowStart[height] = runs.length;
+
+    T components = malloc(sizeof(struct T));
+    assert(components != NULL);
+    components->height = height;
+    components->runs = runs.runs;
+    components->rowStart = rowStart;
+    /* The labels of the runs reuse the union-find */
+    components->labels = runs.parent;
+    components->count = 0;
+
+    uint32_t *label = components->labels;
+    for (uint32_t i = 0; i < runs.length; i++) {
+        if (label[i] == i) {
+            label[i] = ++components->count;
+        } else {
+            /* The root came first, so it already has its label */
+            label[i] = label[label[i]];
+        }
+    }
+
+    components->stats = calloc(components->count + 1,
+                               sizeof(Components_stats));
+    assert(components->stats != NULL);
+    for (int row = 0; row < height; row++) {
+        for (uint32_t i = rowStart[row]; i < rowStart[row + 1]; i++) {
+            addStats(&components->stats[label[i]], &runs.runs[i], row);
+        }
+    }
+    for (int c = 1; c <= components->count; c++) {
+        Components_stats *stats = &components->stats[c];
+        stats->col /= (double)stats->area;
+        stats->row /= (double)stats->area;
+    }
+
+    if (labels != NULL && width > 0) {
+        for (int row = 0; row < height; row++) {
+            /* A UArray2 is one array in row major order */
+            uint32_t *rowLabels = UArray2_at(labels, 0, row);
+            memset(rowLabels, 0, width * sizeof(uint32_t));
+            for (uint32_t i = rowStart[row]; i < rowStart[row + 1]; i++) {
+                for (int col = runs.runs[i].start; col < runs.runs[i].end;
+                     col++) {
+                    rowLabels[col] = label[i];
+                }
+            }
+        }
+    }
+    return components;
+}
+
+/* Components_free
+ *
+ *      Purpose: Free the components.
+ *
+ *   Parameters: A reference to the components, which is set to NULL.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The components are not null.
+ *
+*/
+extern void Components_free(T *components)
+{
+    assert(components != NULL && *components != NULL);
+    free((*components)->stats);
+    free((*components)->runs);
+    free((*components)->rowStart);
+    free((*components)->labels);
+    free(*components);
+    *components = NULL;
+}
+
+/* Components_count
+ *
+ *      Purpose: Get the number of components.
+ *
+ *   Parameters: The components.
+ *
+ *      Returns: The number of components, which is also the largest label.
+ *
+ * Expectations: The components are not null.
+ *
+*/
+extern int Components_count(T components)
+{
+    assert(components != NULL);
+    return components->count;
+}
+
+/* Components_get
+ *
+ *      Purpose: Get the statistics of a component.
+ *
+ *   Parameters: The components and the label.
+ *
+ *      Returns: A pointer to the statistics, valid until the components
+ *               are freed.
+ *
+ * Expectations: 1 <= label <= count.
+ *
+*/
+extern const Components_stats *Components_get(T components, int label)
+{
+    assert(components != NULL);
+    assert(label >= 1 && label <= components->count);
+    return &components->stats[label];
+}
+
+/* Components_remove
+ *
+ *      Purpose: Clear from the bitmap every component that the apply
+ *               function picks, a run at a time.
+ *
+ *   Parameters: The components, the bitmap they were found in, the
+ *               function that is called once per component and returns
+ *               true to remove it, and a closure for it.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The bitmap has not changed since it was labeled.
+ *
+*/
+extern void Components_remove(T components, Bit2_T bitmap,
+    bool apply(int label, const Components_stats *stats, void *cl),
+    void *cl)
+{
+    assert(components != NULL && bitmap != NULL);
+    uint8_t *removed = malloc(components->count + 1);
+    assert(removed != NULL);
+    for (int c = 1; c <= components->count; c++) {
+        removed[c] = apply(c, &components->stats[c], cl);
+    }
+
+    const uint32_t *rowStart = components->rowStart;
+    for (int row = 0; row < components->height; row++) {
+        uint64_t *words = Bit2_row(bitmap, row);
+        for (uint32_t i = rowStart[row]; i < rowStart[row + 1]; i++) {
+            if (removed[components->labels[i]]) {
+                Bit2span_clear(words, components->runs[i].start,
+                               components->runs[i].end);
+            }
+        }
+    }
+    free(removed);
+}
+
+/* findRuns
+ *
+ *      Purpose: Add the black runs of a row, in order, each in a component
+ *               of its own.
+ *
+ *   Parameters: The runs, the words of the row, how many there are, and
+ *               the width of the row.
+ *
+ *      Returns: None.
+ *
+ * Expectations: None.
+ *
+*/
+static void findRuns(struct Runs *runs, const uint64_t *words, int numWords,
+                     int width)
+{
+    int col = Bit2span_next(words, numWords, 0);
+    while (col < width) {
+        int end = Bit2span_end(words, numWords, col);
+        addRun(runs, col, end);
+        col = Bit2span_next(words, numWords, end);
+    }
+}
+
+/* addRun
+ *
+ *      Purpose: Add a run, in a component of its own, doubling the arrays
+ *               when they are full.
+ *
+ *   Parameters: The runs, the first column of the run and the column just
+ *               past it.
+ *
+ *      Returns: None.
+ *
+ * Expectations: None.
+ *
+*/
+static void addRun(struct Runs *runs, int start, int end)
+{
+    if (runs->length == runs->capacity) {
+        assert(runs->capacity < UINT32_MAX / 2);
+        runs->capacity = runs->capacity > 0 ? 2 * runs->capacity : 1024;
+        runs->runs = realloc(runs->runs,
+                             runs->capacity * sizeof(Bit2span_run));
+        runs->parent = realloc(runs->parent,
+                               runs->capacity * sizeof(uint32_t));
+        assert(runs->runs != NULL && runs->parent != NULL);
+    }
+
+    runs->runs[runs->length].start = start;
+    runs->runs[runs->length].end = end;
+    runs->parent[runs->length] = runs->length;
+    runs->length++;
+}
+
+/* joinRows
+ *
+ *      Purpose: Join every pair of runs of two neighboring rows that touch.
+ *
+ *   Parameters: The runs, the range of runs of the upper row, the range
+ *               of runs of the lower row, and how far apart runs can be
+ *               and still touch (1 for corner neighbors, 0 if not).
+ *
+ *      Returns: None.
+ *
+ * Expectations: The rows are neighbors.
+ *
+*/
+static void joinRows(struct Runs *runs, uint32_t i, uint32_t iEnd,
+                     uint32_t j, uint32_t jEnd, int reach)
+{
+    struct Rows rows = { runs->parent, i, j };
+    Bit2span_map_overlaps(&runs->runs[i], iEnd - i, &runs->runs[j],
+                          jEnd - j, reach, linkRuns, &rows);
+}
+
+/* linkRuns
+ *
+ *      Purpose: Join the components of a pair of touching runs. The root
+ *               with the larger index is linked under the other, so each
+ *               root is the first run of its component.
+ *
+ *   Parameters: The index of the run in the upper row and in the lower
+ *               row, and the rows.
+ *
+ *      Returns: None.
+ *
+ * Expectations: None.
+ *
+*/
+static void linkRuns(uint32_t i, uint32_t j, void *cl)
+{
+    struct Rows *rows = cl;
+    uint32_t a = Bit2span_find(rows->parent, rows->upper + i);
+    uint32_t b = Bit2span_find(rows->parent, rows->lower + j);
+    if (a < b) {
+        rows->parent[b] = a;
+    } else {
+        rows->parent[a] = b;
+    }
+}
+
+/* addStats
+ *
+ *      Purpose: Add a run to the statistics of its component. The centroid
+ *               holds the sums of the columns and rows until every run is
+ *               added.
+ *
+ *   Parameters: The statistics, the run and its row.
+ *
+ *      Returns: None.
+ *
+ * Expectations: None.
+ *
+*/
+static void addStats(Components_stats *stats, const Bit2span_run *run,
+                     int row)
+{
+    uint64_t length = run->end - run->start;
+    if (stats->area == 0) {
+        stats->left = run->start;
+        stats->right = run->end - 1;
+        stats->top = row;
+        stats->bottom = row;
+    }
+    stats->area += length;
+    stats->left = run->start < stats->left ? run->start : stats->left;
+    stats->right = run->end - 1 > stats->right ? run->end - 1
+                                               : stats->right;
+    stats->bottom = row;
+    stats->col += (double)(run->start + run->end - 1) / 2.0 * length;
+    stats->row += (double)row * length;
+}
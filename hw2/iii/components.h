@@ -0,0 +1,48 @@
+/* components.h
+ *
+ * By: Drew Maynard and Joel Brandinger, 02/08/22
+ * Interfaces, Implementations, and Images (iii)
+ *
+ * This file contains the interface for labeling the connected components
+ * of black pixels in a bitmap. Components are numbered from 1 in the
+ * order their first pixels appear, row by row; 0 is white. Each one has
+ * its area, bounding box and centroid in a table, and can be cleared
+ * from the bitmap by asking which ones to remove.
+ *
+*/
+
+#ifndef COMPONENTS_INCLUDED
+#define COMPONENTS_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bit2.h"
+#include "uarray2.h"
+
+#define T Components_T
+typedef struct T *T;
+
+/* The statistics of one component. The bounding box is inclusive. */
+typedef struct Components_stats {
+    uint64_t area;
+    int left;
+    int top;
+    int right;
+    int bottom;
+    double col;
+    double row;
+} Components_stats;
+
+extern T Components_label(Bit2_T bitmap, int connectivity,
+                          UArray2_T labels);
+extern void Components_free(T *components);
+
+extern int Components_count(T components);
+extern const Components_stats *Components_get(T components, int label);
+
+extern void Components_remove(T components, Bit2_T bitmap,
+    bool apply(int label, const Components_stats *stats, void *cl),
+    void *cl);
+
+#undef T
+#endif
@@ -0,0 +1,169 @@
+/* componentsTests.c
+ *
+ * By: Drew Maynard and Joel Brandinger, 02/08/22
+ * Interfaces, Implementations, and Images (iii)
+ *
+ * This file tests the components module against a flood fill done one
+ * pixel at a time, on random bitmaps of widths around the word boundaries,
+ * with both connectivities.
+ *
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "components.h"
+#include "bit2ops.h"
+#include "bit2testutil.h"
+
+static int slowLabel(Bit2_T bitmap, int connectivity, int *labels);
+static bool sameStats(const Components_stats *stats, const int *labels,
+                      int label, int width, int height);
+static bool onEdge(int label, const Components_stats *stats, void *cl);
+
+int main(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    const int percents[] = { 30, 55, 80 };
+    startTests();
+
+    for (int i = 0; i < NUM_TEST_WIDTHS; i++) {
+    for (int j = 0; j < NUM_TEST_HEIGHTS; j++) {
+    for (size_t k = 0; k < sizeof(percents) / sizeof(percents[0]); k++) {
+        int width = testWidths[i];
+        int height = testHeights[j];
+        Bit2_T bitmap = randomBitmap(width, height, percents[k]);
+        int *expected = malloc(width * height * sizeof(int));
+        UArray2_T labels = UArray2_new(width, height, sizeof(uint32_t));
+
+        for (int connectivity = 4; connectivity <= 8; connectivity += 4) {
+            int count = slowLabel(bitmap, connectivity, expected);
+            Components_T components = Components_label(bitmap,
+                                                       connectivity,
+                                                       labels);
+            check(Components_count(components) == count, "count", width,
+                  height);
+
+            bool labeled = true;
+            for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col++) {
+                    uint32_t *label = UArray2_at(labels, col, row);
+                    labeled &= (int)*label == expected[row * width + col];
+                }
+            }
+            check(labeled, "labels", width, height);
+
+            bool stats = true;
+            for (int c = 1; c <= count && labeled; c++) {
+                stats &= sameStats(Components_get(components, c),
+                                   expected, c, width, height);
+            }
+            check(stats, "stats", width, height);
+
+            /* Removing what touches the edge is removeBorder */
+            Bit2_T removed = Bit2_new(width, height);
+            Bit2ops_or(removed, bitmap, bitmap);
+            Components_remove(components, removed, onEdge, bitmap);
+            Bit2_T border = Bit2_new(width, height);
+            Bit2ops_or(border, bitmap, bitmap);
+            Bit2ops_removeBorder(border, connectivity);
+            check(same(removed, border), "remove", width, height);
+
+            Bit2_free(&border);
+            Bit2_free(&removed);
+            Components_free(&components);
+        }
+
+        UArray2_free(&labels);
+        free(expected);
+        Bit2_free(&bitmap);
+    }
+    }
+    }
+
+    return finishTests("components");
+}
+
+/* Label by flood filling from each unlabeled black pixel in row major
+ * order, so labels are numbered in the order components first appear */
+static int slowLabel(Bit2_T bitmap, int connectivity, int *labels)
+{
+    int width = Bit2_width(bitmap);
+    int height = Bit2_height(bitmap);
+    int *stack = malloc(width * height * sizeof(int));
+    int count = 0;
+
+    for (int i = 0; i < width * height; i++) {
+        labels[i] = 0;
+    }
+    for (int start = 0; start < width * height; start++) {
+        if (labels[start] != 0 ||
+            !Bit2_get(bitmap, start % width, start / width)) {
+            continue;
+        }
+        int length = 0;
+        labels[start] = ++count;
+        stack[length++] = start;
+        while (length > 0) {
+            int at = stack[--length];
+            for (int dr = -1; dr <= 1; dr++) {
+                for (int dc = -1; dc <= 1; dc++) {
+                    int col = at % width + dc;
+                    int row = at / width + dr;
+                    if ((dr == 0 && dc == 0) ||
+                        (connectivity == 4 && dr != 0 && dc != 0) ||
+                        col < 0 || row < 0 || col >= width ||
+                        row >= height || labels[row * width + col] != 0 ||
+                        !Bit2_get(bitmap, col, row)) {
+                        continue;
+                    }
+                    labels[row * width + col] = count;
+                    stack[length++] = row * width + col;
+                }
+            }
+        }
+    }
+    free(stack);
+    return count;
+}
+
+static bool sameStats(const Components_stats *stats, const int *labels,
+                      int label, int width, int height)
+{
+    uint64_t area = 0;
+    int left = width, top = height, right = -1, bottom = -1;
+    double col = 0.0, row = 0.0;
+
+    for (int r = 0; r < height; r++) {
+        for (int c = 0; c < width; c++) {
+            if (labels[r * width + c] != label) {
+                continue;
+            }
+            area++;
+            left = c < left ? c : left;
+            right = c > right ? c : right;
+            top = r < top ? r : top;
+            bottom = r > bottom ? r : bottom;
+            col += c;
+            row += r;
+        }
+    }
+    return stats->area == area && stats->left == left &&
+           stats->right == right && stats->top == top &&
+           stats->bottom == bottom &&
+           fabs(stats->col - col / area) < 1e-9 &&
+           fabs(stats->row - row / area) < 1e-9;
+}
+
+static bool onEdge(int label, const Components_stats *stats, void *cl)
+{
+    Bit2_T bitmap = cl;
+    (void)label;
+    return stats->left == 0 || stats->top == 0 ||
+           stats->right == Bit2_width(bitmap) - 1 ||
+           stats->bottom == Bit2_height(bitmap) - 1;
+}
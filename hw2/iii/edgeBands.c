@@ -0,0 +1,388 @@
+/* edgeBands.c
+ *
+ * By: Drew Maynard and Joel Brandinger, 02/08/22
+ * Interfaces, Implementations, and Images (iii)
+ *
+ * File contains the implementation of multi-threaded black edge removal.
+ * It runs in four steps, with every band on its own thread in each step:
+ *
+ *   1. Find the black runs of each row of the band, with the word-level
+ *      span search of bit2span.c.
+ *   2. Join every run to the runs it overlaps in the row above, including
+ *      the last row of the band above. Each run is a node of one shared
+ *      union-find whose links are made with compare-and-swap, always from
+ *      the larger index to the smaller, so threads can join at once.
+ *   3. Mark the root of every run that touches the border of the image.
+ *   4. Clear every run whose root is marked.
+ *
+ * Each step only starts when the one before is done on every band.
+ *
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "bit2span.h"
+#include "edgeBands.h"
+
+/* The labels shared by every band: one union-find node per run (numbered
+ * band by band) and a flag per root for components on the border */
+struct Labels {
+    uint32_t *parent;
+    uint8_t *border;
+};
+
+/* The rows of one band, its runs, where each row's runs start, and where
+ * the band's runs start in the numbering of all the runs */
+struct Band {
+    pthread_t thread;
+    Bit2_T bitmap;
+    int first;
+    int last;
+    Bit2span_run *runs;
+    uint32_t numRuns;
+    uint32_t capacity;
+    uint32_t *rowStart;
+    uint32_t offset;
+    struct Band *above;
+    struct Labels *labels;
+};
+
+/* The nodes of the first runs of two neighboring rows, for uniteRuns */
+struct Rows {
+    uint32_t *parent;
+    uint32_t upper;
+    uint32_t lower;
+};
+
+static void runBands(struct Band *bands, int numBands,
+                     void *(*work)(void *));
+static void *findRuns(void *cl);
+static void *joinRuns(void *cl);
+static void *markBorder(void *cl);
+static void *clearRuns(void *cl);
+static void joinRows(uint32_t *parent, struct Band *a, int rowA,
+                     struct Band *b, int rowB);
+static void uniteRuns(uint32_t i, uint32_t j, void *cl);
+static uint32_t find(uint32_t *parent, uint32_t x);
+static void unite(uint32_t *parent, uint32_t a, uint32_t b);
+
+/* removeEdgesParallel
+ *
+ *      Purpose: Remove every black pixel connected to the border of the
+ *               image, using several threads.
+ *
+ *   Parameters: The bitmap and the number of threads (bands) to use.
+ *
+ *      Returns: None.
+ *
+ * Expectations: threads > 0. There are never more bands than rows.
+*/
+void removeEdgesParallel(Bit2_T bitmap, int threads)
+{
+    assert(bitmap != NULL && threads > 0);
+    int height = Bit2_height(bitmap);
+    if (Bit2_width(bitmap) == 0 || height == 0) {
+        return;
+    }
+
+    int numBands = threads < height ? threads : height;
+    struct Band *bands = calloc(numBands, sizeof(struct Band));
+    assert(bands != NULL);
+    struct Labels labels;
+
+    for (int i = 0; i < numBands; i++) {
+        bands[i].bitmap = bitmap;
+        bands[i].first = (int)((int64_t)height * i / numBands);
+        bands[i].last = (int)((int64_t)height * (i + 1) / numBands);
+        bands[i].above = i > 0 ? &bands[i - 1] : NULL;
+        bands[i].labels = &labels;
+    }
+    runBands(bands, numBands, findRuns);
+
+    uint32_t total = 0;
+    for (int i = 0; i < numBands; i++) {
+        bands[i].offset = total;
+        assert(total + bands[i].numRuns >= total);
+        total += bands[i].numRuns;
+    }
+    labels.parent = malloc((total + 1) * sizeof(uint32_t));
+    labels.border = calloc(total + 1, sizeof(uint8_t));
+    assert(labels.parent != NULL && labels.border != NULL);
+    for (uint32_t i = 0; i < total; i++) {
+        labels.parent[i] = i;
+    }
+
+    runBands(bands, numBands, joinRuns);
+    runBands(bands, numBands, markBorder);
+    runBands(bands, numBands, clearRuns);
+
+    for (int i = 0; i < numBands; i++) {
+        free(bands[i].runs);
+        free(bands[i].rowStart);
+    }
+    free(labels.parent);
+    free(labels.border);
+    free(bands);
+}
+
+/* runBands
+ *
+ *      Purpose: Run one step on every band, each on its own thread, and
+ *               wait for all of them to finish.
+ *
+ *   Parameters: The bands, how many there are, and the step.
+ *
+ *      Returns: None.
+ *
+ * Expectations: None.
+*/
+static void runBands(struct Band *bands, int numBands,
+                     void *(*work)(void *))
+{
+    for (int i = 0; i < numBands; i++) {
+        int failed = pthread_create(&bands[i].thread, NULL, work,
+                                    &bands[i]);
+        assert(failed == 0);
+    }
+    for (int i = 0; i < numBands; i++) {
+        pthread_join(bands[i].thread, NULL);
+    }
+}
+
+/* findRuns
+ *
+ *      Purpose: List the black runs of every row of a band, in order.
+ *
+ *   Parameters: The band.
+ *
+ *      Returns: NULL.
+ *
+ * Expectations: None.
+*/
+static void *findRuns(void *cl)
+{
+    struct Band *band = cl;
+    int width = Bit2_width(band->bitmap);
+    int numWords = Bit2_words(band->bitmap);
+    band->rowStart = malloc((band->last - band->first + 1) *
+                            sizeof(uint32_t));
+    assert(band->rowStart != NULL);
+
+    for (int row = band->first; row < band->last; row++) {
+        const uint64_t *words = Bit2_row(band->bitmap, row);
+        band->rowStart[row - band->first] = band->numRuns;
+
+        int col = Bit2span_next(words, numWords, 0);
+        while (col < width) {
+            if (band->numRuns == band->capacity) {
+                band->capacity = band->capacity > 0 ? 2 * band->capacity
+                                                    : 1024;
+                band->runs = realloc(band->runs,
+                                     band->capacity * sizeof(Bit2span_run));
+                assert(band->runs != NULL);
+            }
+            Bit2span_run *run = &band->runs[band->numRuns++];
+            run->start = col;
+            run->end = Bit2span_end(words, numWords, col);
+            col = Bit2span_next(words, numWords, run->end);
+        }
+    }
+    band->rowStart[band->last - band->first] = band->numRuns;
+    return NULL;
+}
+
+/* joinRuns
+ *
+ *      Purpose: Join the runs of a band to the runs they touch in the row
+ *               above, across the top of the band too.
+ *
+ *   Parameters: The band.
+ *
+ *      Returns: NULL.
+ *
+ * Expectations: Every band has found its runs.
+*/
+static void *joinRuns(void *cl)
+{
+    struct Band *band = cl;
+    uint32_t *parent = band->labels->parent;
+
+    if (band->above != NULL) {
+        joinRows(parent, band->above, band->first - 1, band, band->first);
+    }
+    for (int row = band->first + 1; row < band->last; row++) {
+        joinRows(parent, band, row - 1, band, row);
+    }
+    return NULL;
+}
+
+/* markBorder
+ *
+ *      Purpose: Flag the component of every run of a band that touches the
+ *               border of the image.
+ *
+ *   Parameters: The band.
+ *
+ *      Returns: NULL.
+ *
+ * Expectations: Every run has been joined.
+*/
+static void *markBorder(void *cl)
+{
+    struct Band *band = cl;
+    struct Labels *labels = band->labels;
+    int width = Bit2_width(band->bitmap);
+    int height = Bit2_height(band->bitmap);
+
+    for (int row = band->first; row < band->last; row++) {
+        uint32_t end = band->rowStart[row - band->first + 1];
+        for (uint32_t i = band->rowStart[row - band->first]; i < end; i++) {
+            Bit2span_run *run = &band->runs[i];
+            if (row == 0 || row == height - 1 || run->start == 0 ||
+                run->end == width) {
+                uint32_t root = find(labels->parent, band->offset + i);
+                __atomic_store_n(&labels->border[root], 1,
+                                 __ATOMIC_RELAXED);
+            }
+        }
+    }
+    return NULL;
+}
+
+/* clearRuns
+ *
+ *      Purpose: Clear the runs of a band that are part of a component on
+ *               the border.
+ *
+ *   Parameters: The band.
+ *
+ *      Returns: NULL.
+ *
+ * Expectations: Every component on the border has been flagged.
+*/
+static void *clearRuns(void *cl)
+{
+    struct Band *band = cl;
+    struct Labels *labels = band->labels;
+
+    for (int row = band->first; row < band->last; row++) {
+        uint64_t *words = Bit2_row(band->bitmap, row);
+        uint32_t end = band->rowStart[row - band->first + 1];
+        for (uint32_t i = band->rowStart[row - band->first]; i < end; i++) {
+            uint32_t root = find(labels->parent, band->offset + i);
+            if (__atomic_load_n(&labels->border[root], __ATOMIC_RELAXED)) {
+                Bit2span_clear(words, band->runs[i].start,
+                               band->runs[i].end);
+            }
+        }
+    }
+    return NULL;
+}
+
+/* joinRows
+ *
+ *      Purpose: Join every pair of runs of two neighboring rows that share
+ *               a column.
+ *
+ *   Parameters: The union-find, the band and index of the upper row, and
+ *               the band and index of the lower row.
+ *
+ *      Returns: None.
+ *
+ * Expectations: None.
+*/
+static void joinRows(uint32_t *parent, struct Band *a, int rowA,
+                     struct Band *b, int rowB)
+{
+    uint32_t i = a->rowStart[rowA - a->first];
+    uint32_t iEnd = a->rowStart[rowA - a->first + 1];
+    uint32_t j = b->rowStart[rowB - b->first];
+    uint32_t jEnd = b->rowStart[rowB - b->first + 1];
+    struct Rows rows = { parent, a->offset + i, b->offset + j };
+
+    Bit2span_map_overlaps(&a->runs[i], iEnd - i, &b->runs[j], jEnd - j, 0,
+                          uniteRuns, &rows);
+}
+
+/* uniteRuns
+ *
+ *      Purpose: Join the components of a pair of touching runs.
+ *
+ *   Parameters: The index of the run in the upper row and in the lower
+ *               row, and the rows.
+ *
+ *      Returns: None.
+ *
+ * Expectations: None.
+*/
+static void uniteRuns(uint32_t i, uint32_t j, void *cl)
+{
+    struct Rows *rows = cl;
+    unite(rows->parent, rows->upper + i, rows->lower + j);
+}
+
+/* find
+ *
+ *      Purpose: Find the root of a node, halving the path on the way, as
+ *               Bit2span_find does. Other threads may be linking and
+ *               halving at the same time; a halving step is only made if
+ *               the parent has not changed.
+ *
+ *   Parameters: The union-find and the node.
+ *
+ *      Returns: The root.
+ *
+ * Expectations: None.
+*/
+static uint32_t find(uint32_t *parent, uint32_t x)
+{
+    for (;;) {
+        uint32_t p = __atomic_load_n(&parent[x], __ATOMIC_ACQUIRE);
+        if (p == x) {
+            return x;
+        }
+        uint32_t grand = __atomic_load_n(&parent[p], __ATOMIC_ACQUIRE);
+        if (grand != p) {
+            __atomic_compare_exchange_n(&parent[x], &p, grand, false,
+                                        __ATOMIC_RELEASE,
+                                        __ATOMIC_RELAXED);
+        }
+        x = grand;
+    }
+}
+
+/* unite
+ *
+ *      Purpose: Join the components of two nodes. The root with the larger
+ *               index is linked under the other, and only if it is still a
+ *               root; otherwise the roots are found again.
+ *
+ *   Parameters: The union-find and the two nodes.
+ *
+ *      Returns: None.
+ *
+ * Expectations: None.
+*/
+static void unite(uint32_t *parent, uint32_t a, uint32_t b)
+{
+    for (;;) {
+        a = find(parent, a);
+        b = find(parent, b);
+        if (a == b) {
+            return;
+        }
+        if (a < b) {
+            uint32_t swap = a;
+            a = b;
+            b = swap;
+        }
+        uint32_t expected = a;
+        if (__atomic_compare_exchange_n(&parent[a], &expected, b, false,
+                                        __ATOMIC_ACQ_REL,
+                                        __ATOMIC_ACQUIRE)) {
+            return;
+        }
+    }
+}
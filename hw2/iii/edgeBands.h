@@ -0,0 +1,21 @@
+/* edgeBands.h
+ *
+ * By: Drew Maynard and Joel Brandinger, 02/08/22
+ * Interfaces, Implementations, and Images (iii)
+ *
+ * File contains the interface for multi-threaded black edge removal. The
+ * bitmap is cut into bands of rows; the black runs of each band are
+ * labeled on their own thread, the labels are merged across the bands
+ * with a concurrent union-find, and every component with a run on the
+ * border of the image is cleared. The result is the same as removeEdges.
+ *
+*/
+
+#ifndef EDGEBANDS_INCLUDED
+#define EDGEBANDS_INCLUDED
+
+#include "bit2.h"
+
+void removeEdgesParallel(Bit2_T bitmap, int threads);
+
+#endif
@@ -0,0 +1,602 @@
+/* edgeStrips.c
+ *
+ * By: Drew Maynard and Joel Brandinger, 02/08/22
+ * Interfaces, Implementations, and Images (iii)
+ *
+ * File contains the implementation of strip-by-strip black edge removal.
+ *
+ * A black pixel of a strip is connected to the border of the image either
+ * inside the strip, or through a pixel on the first or last row of the
+ * strip that is. So the only thing a strip needs to know about the rest
+ * of the image is which black runs of its first and last rows are on the
+ * border, and those are found in the first pass:
+ *
+ *   1. Every black run on the first or last row of a strip is filled
+ *      from, with the span fill of fixEdge.c kept inside the strip. Each
+ *      fill is one component of the strip; it gets a node in a union-find
+ *      carried through the whole image, joined to the nodes of the runs
+ *      it touches in the last row of the strip above, and the node is
+ *      flagged if the fill reached the border of the image.
+ *   2. When every strip is done, each run on a first or last row looks up
+ *      its flag.
+ *
+ * In the second pass each strip is read with an extra row above and
+ * below it that holds a copy of the flagged runs of its first and last
+ * rows. The extra rows are on the border of the strip, so removeEdges
+ * clears exactly what is connected to the border of the whole image.
+ *
+ * Memory is the strip, the runs of two rows, and one node and flag for
+ * each run on the first and last row of every strip.
+ *
+*/
+
+#include <stdint.h>
+#include <string.h>
+#include "bit2span.h"
+#include "fixEdge.h"
+#include "edgeBands.h"
+#include "edgeStrips.h"
+#include "pbm.h"
+
+#define NONE UINT32_MAX
+
+/* The union-find carried from strip to strip, and a flag per root for
+ * components on the border of the image */
+struct Labels {
+    uint32_t *parent;
+    uint8_t *border;
+    uint32_t count;
+    uint32_t capacity;
+};
+
+/* The runs of the first or last row of a strip, the fill that reached
+ * each, and each one's node */
+struct EdgeRow {
+    Bit2span_run *runs;
+    uint32_t *fills;
+    uint32_t *nodes;
+    uint32_t numRuns;
+    uint32_t capacity;
+};
+
+/* Everything the first pass keeps: the union-find, the stack of the
+ * fills, the edge rows of the strip and the last row of the strip above,
+ * the node of each fill of the strip, and the node of every run on the
+ * first and last row of each strip, in order, which become the runs'
+ * flags at the end */
+struct Labeling {
+    struct Labels labels;
+    struct CoordStack stack;
+    struct EdgeRow rows[2];
+    struct EdgeRow above;
+    uint32_t *fillNodes;
+    uint32_t fillCapacity;
+    uint32_t *edges;
+    size_t numEdges;
+    size_t edgeCapacity;
+};
+
+/* Where a strip is: its rows are rows 1 to count of the bitmap, and the
+ * first of them is row first of an image of the given height */
+struct Strip {
+    Bit2_T bitmap;
+    int first;
+    int count;
+    int height;
+};
+
+static void labelStrip(struct Labeling *labeling, struct Strip *strip);
+static void listRuns(struct EdgeRow *edge, Bit2_T bitmap, int row);
+static void joinAbove(struct Labeling *labeling);
+static void joinRun(uint32_t i, uint32_t j, void *cl);
+static uint32_t fill(struct Labeling *labeling, struct Strip *strip,
+                     int col, int row, uint32_t fillNumber);
+static uint32_t reach(struct Labeling *labeling, struct EdgeRow *edge,
+                      int start, uint32_t fillNumber, uint32_t node);
+static void recordRow(struct Labeling *labeling, struct EdgeRow *edge);
+static void seedRow(Bit2_T strip, int extra, int row, const uint32_t *flags,
+                    size_t *next);
+static uint32_t newNode(struct Labels *labels);
+static uint32_t join(struct Labels *labels, uint32_t a, uint32_t b);
+static uint32_t roomFor(uint32_t capacity, uint32_t needed);
+static void *resize(void *array, uint32_t capacity, size_t size);
+static void freeRow(struct EdgeRow *edge);
+
+/* fixEdgeStrips
+ *
+ *      Purpose: Remove the black edges of a pbm image a strip of rows at a
+ *               time, reading the input twice.
+ *
+ *   Parameters: The input file stream (a pbm file that can seek), the
+ *               number of rows in a strip, the number of threads to clear
+ *               each strip with, and whether to write raw (P4) output
+ *               whatever the input was.
+ *
+ *      Returns: None.
+ *
+ * Expectations: stripRows > 0, threads > 0.
+*/
+void fixEdgeStrips(FILE *inputfp, int stripRows, int threads, bool raw)
+{
+    assert(inputfp != NULL && stripRows > 0 && threads > 0);
+    int width, height;
+    Pbm_format format;
+    Pbm_reader reader = Pbm_start(inputfp, &width, &height, &format);
+    if (raw) {
+        format = Pbm_raw;
+    }
+    Pbm_writeHeader(stdout, width, height, format);
+    if (width == 0 || height == 0) {
+        Pbm_finish(&reader);
+        return;
+    }
+
+    int rows = stripRows < height ? stripRows : height;
+    /* Rows 1 to rows hold the strip; row 0 and the row after the strip
+     * are the extra rows of the second pass */
+    struct Strip strip = { Bit2_new(width, rows + 2), 0, 0, height };
+    struct Labeling labeling;
+    memset(&labeling, 0, sizeof(labeling));
+
+    for (strip.first = 0; strip.first < height; strip.first += rows) {
+        strip.count = height - strip.first < rows ? height - strip.first
+                                                  : rows;
+        Pbm_rows(reader, strip.bitmap, 1, strip.count);
+        labelStrip(&labeling, &strip);
+    }
+
+    /* Every node is final now; turn the edge runs' nodes into flags */
+    struct Labels *labels = &labeling.labels;
+    for (size_t i = 0; i < labeling.numEdges; i++) {
+        uint32_t root = Bit2span_find(labels->parent, labeling.edges[i]);
+        labeling.edges[i] = labels->border[root];
+    }
+    free(labels->parent);
+    free(labels->border);
+    CoordStack_free(&labeling.stack);
+    free(labeling.fillNodes);
+    freeRow(&labeling.rows[0]);
+    freeRow(&labeling.rows[1]);
+    freeRow(&labeling.above);
+
+    Pbm_rewind(reader);
+    size_t next = 0;
+    for (strip.first = 0; strip.first < height; strip.first += rows) {
+        strip.count = height - strip.first < rows ? height - strip.first
+                                                  : rows;
+        /* The extra rows have to be the border of the bitmap, so a short
+         * last strip gets a bitmap of its own */
+        if (Bit2_height(strip.bitmap) != strip.count + 2) {
+            Bit2_free(&strip.bitmap);
+            strip.bitmap = Bit2_new(width, strip.count + 2);
+        }
+        Pbm_rows(reader, strip.bitmap, 1, strip.count);
+        seedRow(strip.bitmap, 0, 1, labeling.edges, &next);
+        seedRow(strip.bitmap, strip.count + 1, strip.count, labeling.edges,
+                &next);
+
+        if (threads > 1) {
+            removeEdgesParallel(strip.bitmap, threads);
+        } else {
+            removeEdges(strip.bitmap);
+        }
+        Pbm_writeRows(stdout, strip.bitmap, 1, strip.count, format);
+    }
+    assert(next == labeling.numEdges);
+
+    free(labeling.edges);
+    Bit2_free(&strip.bitmap);
+    Pbm_finish(&reader);
+}
+
+/* labelStrip
+ *
+ *      Purpose: Fill the strip from the runs of its first and last rows in
+ *               the first pass, and record the node of each of those runs.
+ *               The strip is cleared as it is filled.
+ *
+ *   Parameters: The labeling and the strip.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The strip has at least one row.
+*/
+static void labelStrip(struct Labeling *labeling, struct Strip *strip)
+{
+    listRuns(&labeling->rows[0], strip->bitmap, 1);
+    listRuns(&labeling->rows[1], strip->bitmap, strip->count);
+    joinAbove(labeling);
+
+    uint32_t numFills = 0;
+    for (int side = 0; side < 2; side++) {
+        struct EdgeRow *edge = &labeling->rows[side];
+        int row = side == 0 ? 1 : strip->count;
+        for (uint32_t j = 0; j < edge->numRuns; j++) {
+            /* Runs are cleared by the fill that reaches them first */
+            if (Bit2_get(strip->bitmap, edge->runs[j].start, row) == 0) {
+                continue;
+            }
+            if (numFills == labeling->fillCapacity) {
+                labeling->fillCapacity = roomFor(labeling->fillCapacity,
+                                                 numFills + 1);
+                labeling->fillNodes = resize(labeling->fillNodes,
+                                             labeling->fillCapacity,
+                                             sizeof(uint32_t));
+            }
+            labeling->fillNodes[numFills] = fill(labeling, strip,
+                                                 edge->runs[j].start, row,
+                                                 numFills);
+            numFills++;
+        }
+    }
+
+    recordRow(labeling, &labeling->rows[0]);
+    recordRow(labeling, &labeling->rows[1]);
+
+    /* The last row is the row above the next strip */
+    struct EdgeRow last = labeling->rows[1];
+    labeling->rows[1] = labeling->above;
+    labeling->above = last;
+}
+
+/* listRuns
+ *
+ *      Purpose: List the black runs of a row, in order, none of them
+ *               reached by a fill yet.
+ *
+ *   Parameters: The edge row to fill in, the bitmap, and the row.
+ *
+ *      Returns: None.
+ *
+ * Expectations: None.
+*/
+static void listRuns(struct EdgeRow *edge, Bit2_T bitmap, int row)
+{
+    int width = Bit2_width(bitmap);
+    int numWords = Bit2_words(bitmap);
+    const uint64_t *words = Bit2_row(bitmap, row);
+    edge->numRuns = 0;
+
+    int col = Bit2span_next(words, numWords, 0);
+    while (col < width) {
+        if (edge->numRuns == edge->capacity) {
+            edge->capacity = roomFor(edge->capacity, edge->numRuns + 1);
+            edge->runs = resize(edge->runs, edge->capacity,
+                                sizeof(Bit2span_run));
+            edge->fills = resize(edge->fills, edge->capacity,
+                                 sizeof(uint32_t));
+            edge->nodes = resize(edge->nodes, edge->capacity,
+                                 sizeof(uint32_t));
+        }
+        Bit2span_run *run = &edge->runs[edge->numRuns];
+        run->start = col;
+        run->end = Bit2span_end(words, numWords, col);
+        edge->nodes[edge->numRuns++] = NONE;
+        col = Bit2span_next(words, numWords, run->end);
+    }
+}
+
+/* joinAbove
+ *
+ *      Purpose: Give each run of the first row of the strip the node of
+ *               the runs it touches in the last row of the strip above,
+ *               joining their nodes when it touches several.
+ *
+ *   Parameters: The labeling.
+ *
+ *      Returns: None.
+ *
+ * Expectations: None.
+*/
+static void joinAbove(struct Labeling *labeling)
+{
+    struct EdgeRow *above = &labeling->above;
+    struct EdgeRow *first = &labeling->rows[0];
+
+    Bit2span_map_overlaps(above->runs, above->numRuns, first->runs,
+                          first->numRuns, 0, joinRun, labeling);
+}
+
+/* joinRun
+ *
+ *      Purpose: Give a run of the first row of the strip the node of a run
+ *               it touches in the row above, or join the two nodes if it
+ *               already has one.
+ *
+ *   Parameters: The index of the run above and of the run of the first
+ *               row, and the labeling.
+ *
+ *      Returns: None.
+ *
+ * Expectations: None.
+*/
+static void joinRun(uint32_t i, uint32_t j, void *cl)
+{
+    struct Labeling *labeling = cl;
+    struct EdgeRow *above = &labeling->above;
+    struct EdgeRow *first = &labeling->rows[0];
+
+    first->nodes[j] = first->nodes[j] == NONE
+        ? above->nodes[i]
+        : join(&labeling->labels, first->nodes[j], above->nodes[i]);
+}
+
+/* fill
+ *
+ *      Purpose: Clear the component of the strip through a black pixel, a
+ *               run at a time, noting the runs of the first and last rows
+ *               it reaches and whether it reaches the border of the image.
+ *
+ *   Parameters: The labeling, the strip, the column and row of the pixel,
+ *               and the number of this fill.
+ *
+ *      Returns: The node of the component.
+ *
+ * Expectations: The pixel is black.
+*/
+static uint32_t fill(struct Labeling *labeling, struct Strip *strip,
+                     int col, int row, uint32_t fillNumber)
+{
+    struct CoordStack *stack = &labeling->stack;
+    int width = Bit2_width(strip->bitmap);
+    int numWords = Bit2_words(strip->bitmap);
+    uint32_t node = NONE;
+    bool border = false;
+    pushCoord(stack, col, row);
+
+    while (stack->length > 0) {
+        uint64_t coord = CoordStack_pop(stack);
+        col = (int)(uint32_t)coord;
+        row = (int)(coord >> 32);
+        if (Bit2_get(strip->bitmap, col, row) == 0) {
+            continue;
+        }
+
+        uint64_t *words = Bit2_row(strip->bitmap, row);
+        int start = Bit2span_start(words, col);
+        int end = Bit2span_end(words, numWords, col);
+        Bit2span_clear(words, start, end);
+
+        int imageRow = strip->first + row - 1;
+        if (start == 0 || end == width || imageRow == 0 ||
+            imageRow == strip->height - 1) {
+            border = true;
+        }
+        if (row == 1) {
+            node = reach(labeling, &labeling->rows[0], start, fillNumber,
+                         node);
+        }
+        if (row == strip->count) {
+            node = reach(labeling, &labeling->rows[1], start, fillNumber,
+                         node);
+        }
+
+        if (row > 1) {
+            seedSpans(stack, Bit2_row(strip->bitmap, row - 1), row - 1,
+                      start, end);
+        }
+        if (row < strip->count) {
+            seedSpans(stack, Bit2_row(strip->bitmap, row + 1), row + 1,
+                      start, end);
+        }
+    }
+
+    if (node == NONE) {
+        node = newNode(&labeling->labels);
+    }
+    if (border) {
+        struct Labels *labels = &labeling->labels;
+        labels->border[Bit2span_find(labels->parent, node)] = 1;
+    }
+    return node;
+}
+
+/* reach
+ *
+ *      Purpose: Note that a fill reached a run of an edge row, and join
+ *               the run's node (from the strip above) to the fill's.
+ *
+ *   Parameters: The labeling, the edge row, the column where the run
+ *               starts, the number of the fill, and the fill's node so
+ *               far (NONE if it has none yet).
+ *
+ *      Returns: The fill's node.
+ *
+ * Expectations: The edge row has a run starting at that column.
+*/
+static uint32_t reach(struct Labeling *labeling, struct EdgeRow *edge,
+                      int start, uint32_t fillNumber, uint32_t node)
+{
+    uint32_t low = 0;
+    uint32_t high = edge->numRuns;
+    while (high - low > 1) {
+        uint32_t middle = low + (high - low) / 2;
+        if (edge->runs[middle].start <= start) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    assert(low < edge->numRuns && edge->runs[low].start == start);
+
+    edge->fills[low] = fillNumber;
+    if (edge->nodes[low] == NONE) {
+        return node;
+    }
+    return node == NONE ? edge->nodes[low]
+                        : join(&labeling->labels, node, edge->nodes[low]);
+}
+
+/* recordRow
+ *
+ *      Purpose: Give every run of an edge row the node of the fill that
+ *               reached it, and record the nodes.
+ *
+ *   Parameters: The labeling and the edge row.
+ *
+ *      Returns: None.
+ *
+ * Expectations: Every run of the row has been reached.
+*/
+static void recordRow(struct Labeling *labeling, struct EdgeRow *edge)
+{
+    size_t needed = labeling->numEdges + edge->numRuns;
+    if (needed > labeling->edgeCapacity) {
+        while (needed > labeling->edgeCapacity) {
+            labeling->edgeCapacity = labeling->edgeCapacity > 0
+                                   ? 2 * labeling->edgeCapacity : 1024;
+        }
+        labeling->edges = realloc(labeling->edges, labeling->edgeCapacity *
+                                                   sizeof(uint32_t));
+        assert(labeling->edges != NULL);
+    }
+
+    for (uint32_t j = 0; j < edge->numRuns; j++) {
+        edge->nodes[j] = labeling->fillNodes[edge->fills[j]];
+        labeling->edges[labeling->numEdges++] = edge->nodes[j];
+    }
+}
+
+/* seedRow
+ *
+ *      Purpose: Fill an extra row of the strip with the runs of a row of
+ *               the strip that are connected to the border of the image.
+ *
+ *   Parameters: The strip, the extra row, the row it copies, the flags of
+ *               every run on a first or last row, and the index of the
+ *               flag of the row's first run, which is moved past its last.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The runs of the row are the ones seen in the first pass.
+*/
+static void seedRow(Bit2_T strip, int extra, int row, const uint32_t *flags,
+                    size_t *next)
+{
+    int width = Bit2_width(strip);
+    int numWords = Bit2_words(strip);
+    const uint64_t *words = Bit2_row(strip, row);
+    uint64_t *seeds = Bit2_row(strip, extra);
+    memcpy(seeds, words, numWords * sizeof(uint64_t));
+
+    int col = Bit2span_next(words, numWords, 0);
+    while (col < width) {
+        int end = Bit2span_end(words, numWords, col);
+        if (!flags[(*next)++]) {
+            Bit2span_clear(seeds, col, end);
+        }
+        col = Bit2span_next(words, numWords, end);
+    }
+}
+
+/* newNode
+ *
+ *      Purpose: Add a node of its own to the carried union-find.
+ *
+ *   Parameters: The union-find.
+ *
+ *      Returns: The node.
+ *
+ * Expectations: None.
+*/
+static uint32_t newNode(struct Labels *labels)
+{
+    assert(labels->count < NONE);
+    if (labels->count == labels->capacity) {
+        labels->capacity = roomFor(labels->capacity, labels->count + 1);
+        labels->parent = resize(labels->parent, labels->capacity,
+                                sizeof(uint32_t));
+        labels->border = resize(labels->border, labels->capacity,
+                                sizeof(uint8_t));
+    }
+    labels->parent[labels->count] = labels->count;
+    labels->border[labels->count] = 0;
+    return labels->count++;
+}
+
+/* join
+ *
+ *      Purpose: Join the components of two nodes of the carried union-find,
+ *               linking the root with the larger index under the other
+ *               and keeping its flag.
+ *
+ *   Parameters: The union-find and the two nodes.
+ *
+ *      Returns: The root of the joined component.
+ *
+ * Expectations: None.
+*/
+static uint32_t join(struct Labels *labels, uint32_t a, uint32_t b)
+{
+    a = Bit2span_find(labels->parent, a);
+    b = Bit2span_find(labels->parent, b);
+    if (a > b) {
+        uint32_t swap = a;
+        a = b;
+        b = swap;
+    }
+    if (a != b) {
+        labels->parent[b] = a;
+        labels->border[a] |= labels->border[b];
+    }
+    return a;
+}
+
+/* roomFor
+ *
+ *      Purpose: Find the capacity an array should grow to, doubling its
+ *               capacity until it holds enough elements.
+ *
+ *   Parameters: The current capacity (may be 0) and the number of
+ *               elements needed.
+ *
+ *      Returns: The new capacity.
+ *
+ * Expectations: None.
+*/
+static uint32_t roomFor(uint32_t capacity, uint32_t needed)
+{
+    if (capacity == 0) {
+        capacity = 1024;
+    }
+    while (capacity < needed) {
+        assert(capacity <= UINT32_MAX / 2);
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+/* resize
+ *
+ *      Purpose: Change the capacity of an array.
+ *
+ *   Parameters: The array (may be NULL), the new capacity, and the size of
+ *               an element.
+ *
+ *      Returns: The array, which may have moved.
+ *
+ * Expectations: None.
+*/
+static void *resize(void *array, uint32_t capacity, size_t size)
+{
+    array = realloc(array, capacity * size);
+    assert(array != NULL);
+    return array;
+}
+
+/* freeRow
+ *
+ *      Purpose: Free the arrays of an edge row.
+ *
+ *   Parameters: The edge row.
+ *
+ *      Returns: None.
+ *
+ * Expectations: None.
+*/
+static void freeRow(struct EdgeRow *edge)
+{
+    free(edge->runs);
+    free(edge->fills);
+    free(edge->nodes);
+}
@@ -0,0 +1,23 @@
+/* edgeStrips.h
+ *
+ * By: Drew Maynard and Joel Brandinger, 02/08/22
+ * Interfaces, Implementations, and Images (iii)
+ *
+ * File contains the interface for black edge removal on images that are
+ * too large to hold in memory. The image is read twice, a strip of rows
+ * at a time: the first pass labels the black runs of each strip and
+ * carries the labels of the runs on its first and last rows from strip to
+ * strip, and the second pass clears each strip using what the first pass
+ * learned about those rows. The result is the same as removeEdges.
+ *
+*/
+
+#ifndef EDGESTRIPS_INCLUDED
+#define EDGESTRIPS_INCLUDED
+
+#include <stdio.h>
+#include <stdbool.h>
+
+void fixEdgeStrips(FILE *inputfp, int stripRows, int threads, bool raw);
+
+#endif
@@ -5,97 +5,83 @@
  *
  * File contains the implementation for the fixEdge program. These
  * functions will use the bit2 class to manipulate the data from a
- * supplied pbm P1 image. It will allow user to remove the black
+ * supplied pbm (P1 or P4) image. It will allow user to remove the black
  * edges in the image.
  *
 */
 
+#include <stdint.h>
 #include "fixEdge.h"
-#include "stack.h"
-
-void placeBit(int i, int j, Bit2_T bitmap, int bit, void *cl);
-Bit2_T pbmread(FILE *inputfp);
-void pbmwrite(FILE *outputfp, Bit2_T bitmap);
-void removeEdges(Bit2_T bitmap);
-void dfsRemove(Bit2_T bitmap, int col, int row);
-void getNeighbors(Stack_T stack, Bit2_T bitmap, int col, int row);
-bool inBounds(int maxRow, int maxCol, int row, int col);
-Node newNode(Bit2_T bitmap, int col, int row);
-void print(int i, int j, Bit2_T a, int b, void *p1); 
-
-#define Node Node
-
-struct Node {
-    int x;
-    int y;
-    int bit;
+#include "edgeBands.h"
+#include "pbm.h"
+#include "components.h"
+
+/* What removeComponents clears: components on the edge of this bitmap,
+ * and components of fewer than minArea pixels */
+struct Unwanted {
+    Bit2_T bitmap;
+    int minArea;
 };
 
+void removeRow(Bit2_T bitmap, int row, struct CoordStack *stack);
+void spanRemove(Bit2_T bitmap, int col, int row, struct CoordStack *stack);
+bool unwanted(int label, const Components_stats *stats, void *cl);
+
 /* fixEdge
  *
  *      Purpose: Runs all operations needed to fix the edges on the image.
  *
- *   Parameters: The input file stream (Assumed to be a pbm)
+ *   Parameters: The input file stream (Assumed to be a pbm), the number
+ *               of threads to remove the edges with, the area below which
+ *               components are removed as specks too (0 for none), and
+ *               whether to write raw (P4) output whatever the input was
  *
  *      Returns: None.
  *
- * Expectations: None.
+ * Expectations: threads > 0, minArea >= 0
 */
-void fixEdge(FILE *inputfp)
+void fixEdge(FILE *inputfp, int threads, int minArea, bool raw)
 {
-    Bit2_T bitmap = pbmread(inputfp);
+    Pbm_format format;
+    Bit2_T bitmap = Pbm_read(inputfp, &format);
     assert(bitmap);
-    removeEdges(bitmap);
-    pbmwrite(stdout, bitmap);
+    if (minArea > 0) {
+        removeComponents(bitmap, minArea);
+    } else if (threads > 1) {
+        removeEdgesParallel(bitmap, threads);
+    } else {
+        removeEdges(bitmap);
+    }
+    Pbm_write(stdout, bitmap, raw ? Pbm_raw : format);
     Bit2_free(&bitmap);
 }
 
-/* pbmread
- *
- *      Purpose: Read in the pbm image and store the data in a 2D bit vector
+/* fixEdgeRuns
  *
- *   Parameters: The input file stream (Assumed to be a pbm)
+ *      Purpose: Remove the black edges of an image held as its black runs,
+ *               for mostly white images that take far less memory that way
  *
- *      Returns: The bit2 vector
- *
- * Expectations: None 
-*/
-Bit2_T pbmread(FILE *inputfp)
-{
-    Pnmrdr_T image = Pnmrdr_new(inputfp);
-    Pnmrdr_mapdata data = Pnmrdr_data(image);
-    assert(data.type == 1);
-    Bit2_T bitmap = Bit2_new(data.width, data.height);
-    Bit2_map_row_major(bitmap, placeBit, image);
-    Pnmrdr_free(&image);
-    
-    return bitmap;
-}
-
-/* placeBit
- *
- *      Purpose: Function is made to be used as the apply functions when
- *               mapping the bitmap in row major order. Places a bit in the
- *               correct location.
- *
- *   Parameters: The column, row, bitmap instance, the bit to place, and the
- *               instance of the Pnmrdr reader that reads the bits from input.
+ *   Parameters: The input file stream (Assumed to be a pbm), and whether
+ *               to write raw (P4) output whatever the input was
  *
  *      Returns: None.
  *
- * Expectations: cl is a pnmrdr instance and bitmap is Bit2.
+ * Expectations: None
 */
-void placeBit(int i, int j, Bit2_T bitmap, int bit, void *cl)
+void fixEdgeRuns(FILE *inputfp, bool raw)
 {
-    Bit2_put(bitmap, i, j, Pnmrdr_get(cl));
-    (void)bit;
+    Pbm_format format;
+    Bit2rle_T bit2 = Pbm_readRuns(inputfp, &format);
+    Bit2rle_removeBorder(bit2, 4);
+    Pbm_writeRuns(stdout, bit2, raw ? Pbm_raw : format);
+    Bit2rle_free(&bit2);
 }
 
 /* removeEdges
  *
  *      Purpose: Iterate along all the edges, if a bit is marked as black on
- *               the outside, then mark as white and run a dfs search on that
- *               outside black bit.
+ *               the outside, then fill everything connected to it with
+ *               white. One stack is shared by every fill.
  *
  *   Parameters: The instance of the bitmap
  *
@@ -105,216 +91,191 @@ void placeBit(int i, int j, Bit2_T bitmap, int bit, void *cl)
 */
 void removeEdges(Bit2_T bitmap)
 {
-    /* top row */
-    for (int i = 0; i < Bit2_width(bitmap); i++) {
-        if (Bit2_get(bitmap, i, 0) == 1) {
-            dfsRemove(bitmap, i, 0);
-        }
+    if (Bit2_width(bitmap) == 0 || Bit2_height(bitmap) == 0) {
+        return;
     }
 
+    struct CoordStack stack = { NULL, 0, 0 };
+
+    /* top row */
+    removeRow(bitmap, 0, &stack);
+
     /* right column */
     for (int i = 0; i < Bit2_height(bitmap); i++) {
         if (Bit2_get(bitmap, Bit2_width(bitmap) - 1, i) == 1) {
-            dfsRemove(bitmap, Bit2_width(bitmap) - 1, i);
+            spanRemove(bitmap, Bit2_width(bitmap) - 1, i, &stack);
         }
     }
 
     /* bottom row */
-    for (int i = Bit2_width(bitmap) - 1; i >= 0; i--) {
-        if (Bit2_get(bitmap, i, Bit2_height(bitmap) - 1) == 1) {
-            dfsRemove(bitmap, i, Bit2_height(bitmap) - 1);
-        }
-    }
+    removeRow(bitmap, Bit2_height(bitmap) - 1, &stack);
 
     /* left side */
     for (int i = Bit2_height(bitmap) - 1; i >= 0; i--) {
         if (Bit2_get(bitmap, 0, i) == 1) {
-            dfsRemove(bitmap, 0, i);
+            spanRemove(bitmap, 0, i, &stack);
         }
     }
+
+    CoordStack_free(&stack);
 }
 
-/* dfsRemove
+/* removeComponents
  *
- *      Purpose: Start at a position in a bitmap and remove all black 
- *               bits that are connected to the starting node.
+ *      Purpose: Label every black component, then clear the ones whose
+ *               bounding box touches the edge of the image (which are the
+ *               ones removeEdges clears) and the ones smaller than an
+ *               area. Labeling costs more than filling from the edges, so
+ *               this is only used when specks are removed too.
  *
- *   Parameters: The bitmap, the column, and the row
+ *   Parameters: The instance of the bitmap and the smallest area to keep
  *
  *      Returns: None
  *
- * Expectations: Checks to make sure bitmap is updated correctly.
+ * Expectations: None
 */
-void dfsRemove(Bit2_T bitmap, int col, int row)
+void removeComponents(Bit2_T bitmap, int minArea)
 {
-    Node element = newNode(bitmap, col, row);
-    Stack_T stack = Stack_new();
-    Stack_push(stack, element);
-
-    while (!Stack_isEmpty(stack)) {
-        element = Stack_pop(stack);
-        for (int i = 0; i < 4; i++) {
-            getNeighbors(stack, bitmap, element->x, element->y);
-        }
-        Bit2_put(bitmap, element->x, element->y, 0);
-        free(element);
-    }
-
-    Stack_free(&stack);
+    struct Unwanted query = { bitmap, minArea };
+    Components_T components = Components_label(bitmap, 4, NULL);
+    Components_remove(components, bitmap, unwanted, &query);
+    Components_free(&components);
 }
 
-/* getNeighbors
+/* unwanted
  *
- *      Purpose: Gets all valid adjacent elements and adds them onto the
- *               stack if they are marked as black. Makes sure neighbor is
- *               in bounds and is black.
+ *      Purpose: Tell removeComponents whether to clear a component
  *
- *   Parameters: The stack, bitmap, origonal column and row 
- *               index.
+ *   Parameters: The label and statistics of the component, and the
+ *               Unwanted query
  *
- *      Returns: None
+ *      Returns: True if it is on the edge or too small
  *
  * Expectations: None
 */
-void getNeighbors(Stack_T stack, Bit2_T bitmap, int col, int row)
+bool unwanted(int label, const Components_stats *stats, void *cl)
 {
-    int maxCol = Bit2_width(bitmap) - 1;
-    int maxRow = Bit2_height(bitmap) - 1;
-
-    if (inBounds(maxCol, maxRow, col, row - 1)) {
-        if (Bit2_get(bitmap, col, row - 1) == 1) {
-            Node element = newNode(bitmap, col, row - 1);
-            Stack_push(stack, element);
-        }
-    }
-
-    if (inBounds(maxCol, maxRow, col + 1, row)) {
-        if (Bit2_get(bitmap, col + 1, row) == 1) {
-            Node element = newNode(bitmap, col + 1, row);
-            Stack_push(stack, element);
-        }
-    }
-
-    if (inBounds(maxCol, maxRow, col, row + 1)) {
-        if (Bit2_get(bitmap, col, row + 1) == 1) {
-            Node element = newNode(bitmap, col, row + 1);
-            Stack_push(stack, element);
-        }
-    }
-
-    if (inBounds(maxCol, maxRow, col - 1, row)) {
-        if (Bit2_get(bitmap, col - 1, row) == 1) {
-            Node element = newNode(bitmap, col - 1, row);
-            Stack_push(stack, element);
-        }
-    }
+    struct Unwanted *query = cl;
+    (void)label;
+    return stats->left == 0 || stats->top == 0 ||
+           stats->right == Bit2_width(query->bitmap) - 1 ||
+           stats->bottom == Bit2_height(query->bitmap) - 1 ||
+           stats->area < (uint64_t)query->minArea;
 }
 
-/* inBounds
+/* removeRow
  *
- *      Purpose: Makes sure a row and column index is in bounds.
+ *      Purpose: Fill from every black bit of a border row. The row is read
+ *               a word at a time, so runs of white cost one test per 64
+ *               pixels, and each black bit is found with a count of
+ *               trailing zeros.
  *
- *   Parameters: The maximum column and row index.
+ *   Parameters: The instance of the bitmap, the row and the stack
  *
- *      Returns: True if it is in bounds.
+ *      Returns: None
  *
- * Expectations: column and row indices are valid.
+ * Expectations: None
 */
-bool inBounds(int maxRow, int maxCol, int row, int col)
+void removeRow(Bit2_T bitmap, int row, struct CoordStack *stack)
 {
-    if (row <= maxRow && row >= 0 && col <= maxCol && col >= 0) {
-        return true;
+    for (int w = 0; w < Bit2_words(bitmap); w++) {
+        uint64_t bits;
+        /* Re-read the word after every fill, which may have cleared
+           more of it */
+        while ((bits = Bit2_getword(bitmap, w, row)) != 0) {
+            spanRemove(bitmap, 64 * w + __builtin_ctzll(bits), row, stack);
+        }
     }
-
-    return false;
 }
 
-/* newNode
+/* spanRemove
  *
- *      Purpose: Create a new node on the heap so that an object can be
- *               placed onto the stack that represents a specific element
- *               in the bitmap.
+ *      Purpose: Start at a position in a bitmap and remove all black 
+ *               bits that are connected to it, a horizontal run at a time.
+ *               The run through a seed is found and cleared with whole
+ *               words, and only the first pixel of each black run that
+ *               touches it in the rows above and below is pushed as a new
+ *               seed. The work is per run, not per pixel.
  *
- *   Parameters: The bitmap, the column, and the row.
+ *   Parameters: The bitmap, the column, the row, and the stack to use
+ *               (empty, and left empty)
  *
- *      Returns: A pointer to the node.
+ *      Returns: None
  *
- * Expectations: The memory is allocated and the position in bitmap is black
+ * Expectations: None
 */
-Node newNode(Bit2_T bitmap, int col, int row)
+void spanRemove(Bit2_T bitmap, int col, int row, struct CoordStack *stack)
 {
-    Node nodep = (void*)malloc(sizeof(struct Node));
-    assert(nodep != NULL);
-    assert(Bit2_get(bitmap, col, row) == 1);
+    int height = Bit2_height(bitmap);
+    int numWords = Bit2_words(bitmap);
+    pushCoord(stack, col, row);
+
+    while (stack->length > 0) {
+        uint64_t coord = CoordStack_pop(stack);
+        col = (int)(uint32_t)coord;
+        row = (int)(coord >> 32);
+        /* Another run may have reached this seed first */
+        if (Bit2_get(bitmap, col, row) == 0) {
+            continue;
+        }
 
-    nodep->x = col;
-    nodep->y = row;
-    nodep->bit = 1;
-    return nodep;
+        uint64_t *words = Bit2_row(bitmap, row);
+        int start = Bit2span_start(words, col);
+        int end = Bit2span_end(words, numWords, col);
+        Bit2span_clear(words, start, end);
+
+        if (row > 0) {
+            seedSpans(stack, Bit2_row(bitmap, row - 1), row - 1, start,
+                      end);
+        }
+        if (row < height - 1) {
+            seedSpans(stack, Bit2_row(bitmap, row + 1), row + 1, start,
+                      end);
+        }
+    }
 }
 
-/* pbmwrite
+/* seedSpans
  *
- *      Purpose: Prints the revised image out in P1 format.
+ *      Purpose: Push the first pixel of every black run of a row that has
+ *               pixels in the given columns. Runs start where a bit is set
+ *               and the bit before it (carried over from the previous word)
+ *               is not.
  *
- *   Parameters: The output file stream and the bitmap.
+ *   Parameters: The stack, the words and index of the row, the first
+ *               column and the column just past the last
  *
  *      Returns: None
  *
- * Expectations: File stream is not null, bitmap is not null
+ * Expectations: start < end
 */
-void pbmwrite(FILE *outputfp, Bit2_T bitmap)
+void seedSpans(struct CoordStack *stack, const uint64_t *words, int row,
+               int start, int end)
 {
-    assert(outputfp != NULL);
-    assert(bitmap != NULL);
-
-    fprintf(outputfp, "%s\n", "P1");
-    fprintf(outputfp, "%d %d\n", Bit2_width(bitmap), Bit2_height(bitmap));
-
-    Bit2_map_row_major(bitmap, print, outputfp);
+    uint64_t carry = 0;
+    for (int w = start / 64; w <= (end - 1) / 64; w++) {
+        uint64_t bits = words[w] & Bit2span_mask(w, start, end);
+        uint64_t starts = bits & ~((bits << 1) | carry);
+        carry = bits >> 63;
+
+        while (starts != 0) {
+            pushCoord(stack, 64 * w + __builtin_ctzll(starts), row);
+            starts &= starts - 1;
+        }
+    }
 }
 
-/* print
+/* pushCoord
  *
- *      Purpose: Prints the bit of current index.
+ *      Purpose: Push a position onto the stack.
  *
- *   Parameters: The column, the row, the bitmat, the bit at that position,
- *               and the closure argument.
+ *   Parameters: The stack, the column, and the row.
  *
  *      Returns: None
  *
  * Expectations: None
 */
-void print(int i, int j, Bit2_T bitmap, int b, void *p1) 
+void pushCoord(struct CoordStack *stack, int col, int row)
 {
-    assert(p1 != NULL);
-    fprintf(p1, "%d", b);
-    
-    if (i == Bit2_width(bitmap) - 1) {
-        fprintf(p1, "\n");
-    }
-
-    (void)j;
+    CoordStack_push(stack, ((uint64_t)row << 32) | (uint32_t)col);
 }
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
@@ -7,20 +7,29 @@
  *
 */
 
+#ifndef FIXEDGE_INCLUDED
+#define FIXEDGE_INCLUDED
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include <assert.h>
 #include "bit2.h"
-#include <pnmrdr.h>
-
-#define Node Node
-typedef struct Node *Node;
-
-void fixEdge(FILE *inputfp);
-
-#undef Node
-
+#include "bit2span.h"
+#include "stack.h"
 
+/* The pixels still to be filled from, each packed into one word as
+ * (row << 32) | col */
+STACK_DECLARE(CoordStack, uint64_t)
 
+void fixEdge(FILE *inputfp, int threads, int minArea, bool raw);
+void fixEdgeRuns(FILE *inputfp, bool raw);
+void removeEdges(Bit2_T bitmap);
+void removeComponents(Bit2_T bitmap, int minArea);
 
+/* The span fill, shared with edgeStrips.c */
+void seedSpans(struct CoordStack *stack, const uint64_t *words, int row,
+               int start, int end);
+void pushCoord(struct CoordStack *stack, int col, int row);
 
+#endif
@@ -0,0 +1,580 @@
+/* pbm.c
+ *
+ * By: Drew Maynard and Joel Brandinger, 02/08/22
+ * Interfaces, Implementations, and Images (iii)
+ *
+ * This file contains the implementation for the pbm reader and writer.
+ *
+ * NOTE: Input goes through our own buffer instead of getc, so the plain
+ *       scanner only costs a couple of compares per character, and the
+ *       rows of a raw image are copied out of it (or read into a row
+ *       buffer) a whole row at a time.
+ *
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "pbm.h"
+
+#define BUFSIZE (1 << 16)
+#define T Pbm_reader
+
+struct Input {
+    FILE *fp;
+    size_t pos;
+    size_t len;
+    unsigned char buffer[BUFSIZE];
+};
+
+/* An image being read a few rows at a time: its header, where its rows
+ * start in the file (-1 if the input cannot seek), and the next row */
+struct T {
+    struct Input in;
+    int width;
+    int height;
+    Pbm_format format;
+    long start;
+    int next;
+};
+
+static int nextByte(struct Input *in);
+static int readNumber(struct Input *in);
+static void skipSpace(struct Input *in);
+static void readPlain(struct Input *in, Bit2_T bitmap, int first,
+                      int count);
+static void readRaw(struct Input *in, Bit2_T bitmap, int first, int count);
+static void readBytes(struct Input *in, unsigned char *bytes, size_t count);
+static void writePlain(FILE *outputfp, Bit2_T bitmap, int first, int count);
+static void writeRaw(FILE *outputfp, Bit2_T bitmap, int first, int count);
+static unsigned char reverse(unsigned char byte);
+
+/* Pbm_read
+ *
+ *      Purpose: Read a plain or raw pbm into a new bitmap.
+ *
+ *   Parameters: The input file stream and a reference that is set to the
+ *               format the image was in (may be NULL).
+ *
+ *      Returns: The bitmap, which the caller frees.
+ *
+ * Expectations: The input is a well-formed P1 or P4 image.
+ *
+*/
+extern Bit2_T Pbm_read(FILE *inputfp, Pbm_format *format)
+{
+    int width, height;
+    T reader = Pbm_start(inputfp, &width, &height, format);
+    Bit2_T bitmap = Bit2_new(width, height);
+    Pbm_rows(reader, bitmap, 0, height);
+    Pbm_finish(&reader);
+    return bitmap;
+}
+
+/* Pbm_write
+ *
+ *      Purpose: Write a bitmap out as a plain or raw pbm.
+ *
+ *   Parameters: The output file stream, the bitmap, and the format.
+ *
+ *      Returns: None.
+ *
+ * Expectations: File stream is not null, bitmap is not null.
+ *
+*/
+extern void Pbm_write(FILE *outputfp, Bit2_T bitmap, Pbm_format format)
+{
+    assert(bitmap != NULL);
+    Pbm_writeHeader(outputfp, Bit2_width(bitmap), Bit2_height(bitmap),
+                    format);
+    Pbm_writeRows(outputfp, bitmap, 0, Bit2_height(bitmap), format);
+}
+
+/* Pbm_readRuns
+ *
+ *      Purpose: Read a plain or raw pbm into a new run-length array, a row
+ *               at a time.
+ *
+ *   Parameters: The input file stream and a reference that is set to the
+ *               format the image was in (may be NULL).
+ *
+ *      Returns: The array, which the caller frees.
+ *
+ * Expectations: The input is a well-formed P1 or P4 image.
+ *
+*/
+extern Bit2rle_T Pbm_readRuns(FILE *inputfp, Pbm_format *format)
+{
+    int width, height;
+    T reader = Pbm_start(inputfp, &width, &height, format);
+    Bit2rle_T bit2 = Bit2rle_new(width, height);
+    Bit2_T row = Bit2_new(width, 1);
+    for (int j = 0; j < height; j++) {
+        Pbm_rows(reader, row, 0, 1);
+        Bit2rle_putRow(bit2, j, Bit2_row(row, 0));
+    }
+    Bit2_free(&row);
+    Pbm_finish(&reader);
+    return bit2;
+}
+
+/* Pbm_writeRuns
+ *
+ *      Purpose: Write a run-length array out as a plain or raw pbm, a row
+ *               at a time.
+ *
+ *   Parameters: The output file stream, the array, and the format.
+ *
+ *      Returns: None.
+ *
+ * Expectations: File stream is not null, the array is not null.
+ *
+*/
+extern void Pbm_writeRuns(FILE *outputfp, Bit2rle_T bit2,
+                          Pbm_format format)
+{
+    assert(bit2 != NULL);
+    int width = Bit2rle_width(bit2);
+    int height = Bit2rle_height(bit2);
+    Bit2_T row = Bit2_new(width, 1);
+    Pbm_writeHeader(outputfp, width, height, format);
+    for (int j = 0; j < height; j++) {
+        Bit2rle_getRow(bit2, j, Bit2_row(row, 0));
+        Pbm_writeRows(outputfp, row, 0, 1, format);
+    }
+    Bit2_free(&row);
+}
+
+/* Pbm_start
+ *
+ *      Purpose: Read the header of a plain or raw pbm, leaving its rows to
+ *               be read with Pbm_rows.
+ *
+ *   Parameters: The input file stream and references that are set to the
+ *               width and height of the image and the format it is in
+ *               (the format may be NULL).
+ *
+ *      Returns: The reader, which the caller finishes with Pbm_finish.
+ *
+ * Expectations: The input is a well-formed P1 or P4 image.
+ *
+*/
+extern T Pbm_start(FILE *inputfp, int *width, int *height,
+                   Pbm_format *format)
+{
+    assert(inputfp != NULL && width != NULL && height != NULL);
+    T reader = malloc(sizeof(struct T));
+    assert(reader != NULL);
+    struct Input *in = &reader->in;
+    in->fp = inputfp;
+    in->pos = 0;
+    in->len = 0;
+
+    int magic = nextByte(in);
+    int kind = nextByte(in);
+    assert(magic == 'P' && (kind == '1' || kind == '4'));
+    reader->width = readNumber(in);
+    reader->height = readNumber(in);
+    /* Exactly one whitespace character ends the header */
+    int separator = nextByte(in);
+    assert(separator == ' ' || separator == '\t' || separator == '\n' ||
+           separator == '\r');
+
+    reader->format = kind == '1' ? Pbm_plain : Pbm_raw;
+    long offset = ftell(inputfp);
+    reader->start = offset < 0 ? -1 : offset - (long)(in->len - in->pos);
+    reader->next = 0;
+
+    *width = reader->width;
+    *height = reader->height;
+    if (format != NULL) {
+        *format = reader->format;
+    }
+    return reader;
+}
+
+/* Pbm_rows
+ *
+ *      Purpose: Read the next rows of the image into rows of a bitmap.
+ *
+ *   Parameters: The reader, the bitmap, the first row of the bitmap to
+ *               fill, and how many rows to read.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The bitmap is as wide as the image and has those rows, and
+ *               the image has that many rows left.
+ *
+*/
+extern void Pbm_rows(T reader, Bit2_T bitmap, int first, int count)
+{
+    assert(reader != NULL && bitmap != NULL);
+    assert(Bit2_width(bitmap) == reader->width);
+    assert(first >= 0 && count >= 0 && first + count <= Bit2_height(bitmap));
+    assert(count <= reader->height - reader->next);
+
+    if (reader->format == Pbm_plain) {
+        readPlain(&reader->in, bitmap, first, count);
+    } else {
+        readRaw(&reader->in, bitmap, first, count);
+    }
+    reader->next += count;
+}
+
+/* Pbm_rewind
+ *
+ *      Purpose: Go back to the first row of the image.
+ *
+ *   Parameters: The reader.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The input is a file that can seek.
+ *
+*/
+extern void Pbm_rewind(T reader)
+{
+    assert(reader != NULL);
+    assert(reader->start >= 0);
+    int failed = fseek(reader->in.fp, reader->start, SEEK_SET);
+    assert(failed == 0);
+    reader->in.pos = 0;
+    reader->in.len = 0;
+    reader->next = 0;
+}
+
+/* Pbm_finish
+ *
+ *      Purpose: Free a reader. The input file is left open.
+ *
+ *   Parameters: A reference to the reader, which is set to NULL.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The reader is not null.
+ *
+*/
+extern void Pbm_finish(T *reader)
+{
+    assert(reader != NULL && *reader != NULL);
+    free(*reader);
+    *reader = NULL;
+}
+
+/* Pbm_writeHeader
+ *
+ *      Purpose: Write the header of a plain or raw pbm.
+ *
+ *   Parameters: The output file stream, the width and height of the
+ *               image, and the format.
+ *
+ *      Returns: None.
+ *
+ * Expectations: File stream is not null.
+ *
+*/
+extern void Pbm_writeHeader(FILE *outputfp, int width, int height,
+                            Pbm_format format)
+{
+    assert(outputfp != NULL);
+    fprintf(outputfp, "P%d\n", format == Pbm_plain ? 1 : 4);
+    fprintf(outputfp, "%d %d\n", width, height);
+}
+
+/* Pbm_writeRows
+ *
+ *      Purpose: Write rows of a bitmap as the next rows of a plain or raw
+ *               pbm.
+ *
+ *   Parameters: The output file stream, the bitmap, its first row to
+ *               write, how many rows to write, and the format.
+ *
+ *      Returns: None.
+ *
+ * Expectations: File stream is not null, bitmap is not null and has the
+ *               rows.
+ *
+*/
+extern void Pbm_writeRows(FILE *outputfp, Bit2_T bitmap, int first,
+                          int count, Pbm_format format)
+{
+    assert(outputfp != NULL);
+    assert(bitmap != NULL);
+    assert(first >= 0 && count >= 0 && first + count <= Bit2_height(bitmap));
+    if (Bit2_width(bitmap) == 0) {
+        return;
+    }
+
+    if (format == Pbm_plain) {
+        writePlain(outputfp, bitmap, first, count);
+    } else {
+        writeRaw(outputfp, bitmap, first, count);
+    }
+}
+
+/* readPlain
+ *
+ *      Purpose: Scan the '0' and '1' characters of a P1 raster into the
+ *               bitmap, 64 pixels to a word. Whitespace between them is
+ *               skipped.
+ *
+ *   Parameters: The input, positioned at the start of a row, the bitmap,
+ *               its first row to fill, and how many rows to read.
+ *
+ *      Returns: None.
+ *
+ * Expectations: There are width * count pixels left.
+ *
+*/
+static void readPlain(struct Input *in, Bit2_T bitmap, int first,
+                      int count)
+{
+    int width = Bit2_width(bitmap);
+
+    for (int row = first; row < first + count; row++) {
+        uint64_t *words = Bit2_row(bitmap, row);
+        for (int col = 0; col < width; col += 64) {
+            int pixels = width - col < 64 ? width - col : 64;
+            uint64_t bits = 0;
+            for (int k = 0; k < pixels; k++) {
+                int c = nextByte(in);
+                while (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+                    c = nextByte(in);
+                }
+                assert(c == '0' || c == '1');
+                bits |= (uint64_t)(c - '0') << k;
+            }
+            words[col / 64] = bits;
+        }
+    }
+}
+
+/* readRaw
+ *
+ *      Purpose: Copy the packed rows of a P4 raster into the bitmap,
+ *               reversing the bits of each byte.
+ *
+ *   Parameters: The input, positioned at the start of a row, the bitmap,
+ *               its first row to fill, and how many rows to read.
+ *
+ *      Returns: None.
+ *
+ * Expectations: There are count rows of (width + 7) / 8 bytes left.
+ *
+*/
+static void readRaw(struct Input *in, Bit2_T bitmap, int first, int count)
+{
+    int rowBytes = (Bit2_width(bitmap) + 7) / 8;
+    int numWords = Bit2_words(bitmap);
+    unsigned char *bytes = malloc(rowBytes + 8);
+    assert(bytes != NULL);
+
+    for (int row = first; row < first + count; row++) {
+        readBytes(in, bytes, rowBytes);
+        memset(bytes + rowBytes, 0, 8);
+        for (int w = 0; w < numWords; w++) {
+            uint64_t bits = 0;
+            for (int k = 0; k < 8; k++) {
+                bits |= (uint64_t)reverse(bytes[8 * w + k]) << (8 * k);
+            }
+            /* putword drops the padding bits of the last byte */
+            Bit2_putword(bitmap, w, row, bits);
+        }
+    }
+    free(bytes);
+}
+
+/* writePlain
+ *
+ *      Purpose: Write the rows of a bitmap as P1, each row spelled out in
+ *               a line buffer and written with a single fwrite.
+ *
+ *   Parameters: The output file stream, the bitmap, its first row to
+ *               write, and how many rows to write.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The width is not 0.
+ *
+*/
+static void writePlain(FILE *outputfp, Bit2_T bitmap, int first, int count)
+{
+    int width = Bit2_width(bitmap);
+    char *line = malloc(width + 1);
+    assert(line != NULL);
+    line[width] = '\n';
+
+    for (int row = first; row < first + count; row++) {
+        const uint64_t *words = Bit2_row(bitmap, row);
+        for (int col = 0; col < width; col++) {
+            line[col] = '0' + ((words[col / 64] >> (col % 64)) & 1);
+        }
+        fwrite(line, 1, width + 1, outputfp);
+    }
+    free(line);
+}
+
+/* writeRaw
+ *
+ *      Purpose: Write the rows of a bitmap as P4, eight pixels to a byte
+ *               with the leftmost in the most significant bit.
+ *
+ *   Parameters: The output file stream, the bitmap, its first row to
+ *               write, and how many rows to write.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The width is not 0.
+ *
+*/
+static void writeRaw(FILE *outputfp, Bit2_T bitmap, int first, int count)
+{
+    int rowBytes = (Bit2_width(bitmap) + 7) / 8;
+    unsigned char *bytes = malloc(rowBytes);
+    assert(bytes != NULL);
+
+    for (int row = first; row < first + count; row++) {
+        const uint64_t *words = Bit2_row(bitmap, row);
+        for (int k = 0; k < rowBytes; k++) {
+            bytes[k] = reverse((words[k / 8] >> (8 * (k % 8))) & 0xFF);
+        }
+        fwrite(bytes, 1, rowBytes, outputfp);
+    }
+    free(bytes);
+}
+
+/* nextByte
+ *
+ *      Purpose: Get the next byte of input, refilling the buffer when it
+ *               runs out.
+ *
+ *   Parameters: The input.
+ *
+ *      Returns: The byte, or EOF.
+ *
+ * Expectations: None.
+ *
+*/
+static int nextByte(struct Input *in)
+{
+    if (in->pos == in->len) {
+        in->len = fread(in->buffer, 1, BUFSIZE, in->fp);
+        in->pos = 0;
+        if (in->len == 0) {
+            return EOF;
+        }
+    }
+    return in->buffer[in->pos++];
+}
+
+/* skipSpace
+ *
+ *      Purpose: Skip the whitespace and comments between header fields.
+ *
+ *   Parameters: The input.
+ *
+ *      Returns: None.
+ *
+ * Expectations: None.
+ *
+*/
+static void skipSpace(struct Input *in)
+{
+    for (;;) {
+        int c = nextByte(in);
+        if (c == '#') {
+            while (c != '\n' && c != EOF) {
+                c = nextByte(in);
+            }
+        } else if (c != ' ' && c != '\n' && c != '\r' && c != '\t') {
+            if (c != EOF) {
+                in->pos--;
+            }
+            return;
+        }
+    }
+}
+
+/* readNumber
+ *
+ *      Purpose: Read a number from the header.
+ *
+ *   Parameters: The input.
+ *
+ *      Returns: The number.
+ *
+ * Expectations: A number follows (after whitespace and comments).
+ *
+*/
+static int readNumber(struct Input *in)
+{
+    skipSpace(in);
+    int c = nextByte(in);
+    assert(c >= '0' && c <= '9');
+
+    int number = 0;
+    while (c >= '0' && c <= '9') {
+        assert(number <= (0x7FFFFFFF - (c - '0')) / 10);
+        number = number * 10 + (c - '0');
+        c = nextByte(in);
+    }
+    if (c != EOF) {
+        in->pos--;
+    }
+    return number;
+}
+
+/* readBytes
+ *
+ *      Purpose: Copy bytes of input out of the buffer, reading the rest
+ *               straight from the file.
+ *
+ *   Parameters: The input, where the bytes go, and how many.
+ *
+ *      Returns: None.
+ *
+ * Expectations: The input has that many bytes left.
+ *
+*/
+static void readBytes(struct Input *in, unsigned char *bytes, size_t count)
+{
+    size_t buffered = in->len - in->pos;
+    if (buffered >= count) {
+        memcpy(bytes, in->buffer + in->pos, count);
+        in->pos += count;
+        return;
+    }
+
+    memcpy(bytes, in->buffer + in->pos, buffered);
+    in->pos = in->len;
+    if (count - buffered >= BUFSIZE) {
+        size_t got = fread(bytes + buffered, 1, count - buffered, in->fp);
+        assert(got == count - buffered);
+        return;
+    }
+
+    in->len = fread(in->buffer, 1, BUFSIZE, in->fp);
+    assert(in->len >= count - buffered);
+    memcpy(bytes + buffered, in->buffer, count - buffered);
+    in->pos = count - buffered;
+}
+
+/* reverse
+ *
+ *      Purpose: Reverse the order of the bits of a byte, going between the
+ *               P4 order and ours.
+ *
+ *   Parameters: The byte.
+ *
+ *      Returns: The reversed byte.
+ *
+ * Expectations: None.
+ *
+*/
+static unsigned char reverse(unsigned char byte)
+{
+    byte = (byte & 0xF0) >> 4 | (byte & 0x0F) << 4;
+    byte = (byte & 0xCC) >> 2 | (byte & 0x33) << 2;
+    byte = (byte & 0xAA) >> 1 | (byte & 0x55) << 1;
+    return byte;
+}
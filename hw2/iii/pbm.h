@@ -0,0 +1,53 @@
+/* pbm.h
+ *
+ * By: Drew Maynard and Joel Brandinger, 02/08/22
+ * Interfaces, Implementations, and Images (iii)
+ *
+ * This file contains the interface for the pbm reader and writer. Plain
+ * (P1) and raw (P4) bitmaps are read straight into the packed words of a
+ * Bit2_T and written back out a row at a time. P4 packs the leftmost pixel
+ * of each byte into its most significant bit, so its bytes only have to
+ * be bit-reversed on the way in and out.
+ *
+ * A Pbm_reader reads an image a few rows at a time instead, for programs
+ * that never hold the whole image, and can go back to the first row of a
+ * file to read it again.
+ *
+ * Pbm_readRuns and Pbm_writeRuns do the same for a run-length Bit2rle_T,
+ * going through one packed row at a time, so only the runs of the image
+ * are ever held.
+ *
+*/
+
+#ifndef PBM_INCLUDED
+#define PBM_INCLUDED
+
+#include <stdio.h>
+#include "bit2.h"
+#include "bit2rle.h"
+
+typedef enum { Pbm_plain = 1, Pbm_raw = 4 } Pbm_format;
+
+#define T Pbm_reader
+typedef struct T *T;
+
+extern Bit2_T Pbm_read(FILE *inputfp, Pbm_format *format);
+extern void Pbm_write(FILE *outputfp, Bit2_T bitmap, Pbm_format format);
+extern Bit2rle_T Pbm_readRuns(FILE *inputfp, Pbm_format *format);
+extern void Pbm_writeRuns(FILE *outputfp, Bit2rle_T bit2,
+                          Pbm_format format);
+
+extern T Pbm_start(FILE *inputfp, int *width, int *height,
+                   Pbm_format *format);
+extern void Pbm_rows(T reader, Bit2_T bitmap, int first, int count);
+extern void Pbm_rewind(T reader);
+extern void Pbm_finish(T *reader);
+
+extern void Pbm_writeHeader(FILE *outputfp, int width, int height,
+                            Pbm_format format);
+extern void Pbm_writeRows(FILE *outputfp, Bit2_T bitmap, int first,
+                          int count, Pbm_format format);
+
+#undef T
+
+#endif
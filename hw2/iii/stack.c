@@ -5,40 +5,49 @@
  *
  * This file contains the implementation for the stack data structure.
  *
- * NOTE: Sequence is used for a stack and is in a struct to add an extra
- *       level of abstraction.
+ * NOTE: The elements are copied into one buffer, one after another, which
+ *       doubles in size when it fills up. Stack_grow does the doubling
+ *       for the typed stacks of STACK_DECLARE too.
  *
 */
 
+#include <string.h>
 #include "stack.h"
 
 #define T Stack_T
 
 struct T {
-    Seq_T stack;
+    char *items;
+    size_t elementSize;
+    size_t length;
+    size_t capacity;
 };
 
 /* Stack_new
  *
  *      Purpose: Create a new stack ready for use
- *   Parameters: None
+ *   Parameters: The size in bytes of each element
  *      Returns: A pointer to a newly created stack
  *
- * Expectations: None
+ * Expectations: elementSize > 0
  *
 */
-extern T Stack_new()
+extern T Stack_new(size_t elementSize)
 {
+    assert(elementSize > 0);
     T newStack = (void*)malloc(sizeof(struct T));
     assert(newStack != NULL);
-    newStack->stack = Seq_new(0);
+    newStack->items = NULL;
+    newStack->elementSize = elementSize;
+    newStack->length = 0;
+    newStack->capacity = 0;
     return newStack;
 }
 
 /* Stack_free
  *
- *      Purpose: Free the allocated memory used to hold the sequence
- *   Parameters: A reference to the sequence used to hold the stack
+ *      Purpose: Free the stack and the elements left in it
+ *   Parameters: A reference to the stack, which is set to NULL
  *      Returns: None
  *
  * Expectations: dataStack is not NULL
@@ -46,13 +55,10 @@ extern T Stack_new()
 */
 extern void Stack_free(T *dataStack)
 {
-    assert(dataStack);
-    for (int i = 0; i < Seq_length((*dataStack)->stack); i++) {
-        free(Seq_get((*dataStack)->stack, i));
-    }
-
-    Seq_free(&(*dataStack)->stack);
-    free((*dataStack));
+    assert(dataStack && *dataStack);
+    free((*dataStack)->items);
+    free(*dataStack);
+    *dataStack = NULL;
 }
 
 /* Stack_isEmpty
@@ -67,7 +73,7 @@ extern void Stack_free(T *dataStack)
 extern bool Stack_isEmpty(T dataStack)
 {
     assert(dataStack);
-    return Seq_length(dataStack->stack) == 0;
+    return dataStack->length == 0;
 }
 
 /* Stack_size
@@ -76,64 +82,118 @@ extern bool Stack_isEmpty(T dataStack)
  *   Parameters: The stack instance
  *      Returns: The number of elements
  *
- * Expectations: The element being added is not NULL
+ * Expectations: None
  *
 */
 extern int Stack_size(T dataStack)
 {
     assert(dataStack);
-    return Seq_length(dataStack->stack);
+    return (int)dataStack->length;
 }
 
 /* Stack_push
  *
- *      Purpose: Push an element onto the stack
- *   Parameters: The stack and element to be pushed onto the list
+ *      Purpose: Copy an element onto the stack
+ *   Parameters: The stack and a pointer to the element
  *      Returns: None
  *
- * Expectations: The element being added is not NULL
+ * Expectations: The element is not NULL and is elementSize bytes
  *
 */
-extern void Stack_push(T dataStack, void *elmt)
+extern void Stack_push(T dataStack, const void *elmt)
 {
     assert(dataStack);
     assert(elmt != NULL);
-    Seq_addhi(dataStack->stack, elmt);
+    if (dataStack->length == dataStack->capacity) {
+        Stack_reserve(dataStack, 1);
+    }
+    memcpy(dataStack->items + dataStack->length * dataStack->elementSize,
+           elmt, dataStack->elementSize);
+    dataStack->length++;
 }
 
 /* Stack_pop
  *
  *      Purpose: Pop the top element off the stack
- *   Parameters: The stack instance
- *      Returns: A pointer to the element
+ *   Parameters: The stack instance and where to copy the element (may be
+ *               NULL to drop it)
+ *      Returns: None
  *
- * Expectations: The element being added is not NULL
+ * Expectations: The stack is not empty
  *
 */
-extern void *Stack_pop(T dataStack)
+extern void Stack_pop(T dataStack, void *elmt)
 {
     assert(dataStack);
-    assert(Stack_size(dataStack) > 0);
-    void *element = NULL;
-    element = Seq_remhi(dataStack->stack);
-    return element;
+    assert(dataStack->length > 0);
+    dataStack->length--;
+    if (elmt != NULL) {
+        memcpy(elmt,
+               dataStack->items + dataStack->length * dataStack->elementSize,
+               dataStack->elementSize);
+    }
 }
 
+/* Stack_top
+ *
+ *      Purpose: Look at the top element without popping it
+ *   Parameters: The stack instance
+ *      Returns: A pointer to the element, valid until the next push
+ *
+ * Expectations: The stack is not empty
+ *
+*/
+extern void *Stack_top(T dataStack)
+{
+    assert(dataStack);
+    assert(dataStack->length > 0);
+    return dataStack->items +
+           (dataStack->length - 1) * dataStack->elementSize;
+}
 
+/* Stack_reserve
+ *
+ *      Purpose: Make room for more elements up front, so the next pushes
+ *               do not have to grow the buffer
+ *   Parameters: The stack instance and how many more elements to make
+ *               room for
+ *      Returns: None
+ *
+ * Expectations: None
+ *
+*/
+extern void Stack_reserve(T dataStack, size_t count)
+{
+    assert(dataStack);
+    size_t needed = dataStack->length + count;
+    if (needed > dataStack->capacity) {
+        dataStack->items = Stack_grow(dataStack->items,
+                                      &dataStack->capacity, needed,
+                                      dataStack->elementSize);
+    }
+}
 
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
+/* Stack_grow
+ *
+ *      Purpose: Grow a buffer of elements, doubling its capacity until it
+ *               holds as many as needed
+ *   Parameters: The buffer (may be NULL), a reference to its capacity,
+ *               the number of elements needed, and the size of one
+ *      Returns: The buffer, which may have moved
+ *
+ * Expectations: The memory is available
+ *
+*/
+extern void *Stack_grow(void *items, size_t *capacity, size_t needed,
+                        size_t elementSize)
+{
+    assert(capacity != NULL);
+    size_t newCapacity = *capacity > 0 ? *capacity : 64;
+    while (newCapacity < needed) {
+        newCapacity *= 2;
+    }
+    items = realloc(items, newCapacity * elementSize);
+    assert(items != NULL);
+    *capacity = newCapacity;
+    return items;
+}
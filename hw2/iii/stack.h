@@ -5,12 +5,20 @@
  *
  * This file contains the interface of the stack class.
  *
+ * A Stack_T holds elements of one size by value, in a single buffer that
+ * doubles when it is full, so nothing is allocated per element: push
+ * copies an element in and pop copies it back out.
+ *
+ * STACK_DECLARE(Name, Type) declares a stack of one type instead, as a
+ * plain struct Name { Type *items; size_t length, capacity; } that starts
+ * out zeroed, with inline Name_push, Name_pop, Name_reserve and Name_free
+ * that index the array directly.
+ *
 */
 
 #ifndef STACK_INCLUDED
 #define STACK_INCLUDED
 
-#include <seq.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -19,15 +27,58 @@
 #define T Stack_T
 typedef struct T *T;
 
-extern T Stack_new();
+extern T Stack_new(size_t elementSize);
 extern void Stack_free(T *dataStack);
 
 extern bool Stack_isEmpty(T dataStack);
 extern int Stack_size(T dataStack);
 
-extern void Stack_push(T dataStack, void *elmt);
-extern void *Stack_pop(T dataStack);
+extern void Stack_push(T dataStack, const void *elmt);
+extern void Stack_pop(T dataStack, void *elmt);
+extern void *Stack_top(T dataStack);
+extern void Stack_reserve(T dataStack, size_t count);
+
+extern void *Stack_grow(void *items, size_t *capacity, size_t needed,
+                        size_t elementSize);
 
 #undef T
-#endif
 
+#define STACK_DECLARE(Name, Type)                                          \
+    struct Name {                                                          \
+        Type *items;                                                       \
+        size_t length;                                                     \
+        size_t capacity;                                                   \
+    };                                                                     \
+                                                                           \
+    static inline void Name##_reserve(struct Name *stack, size_t count)   \
+    {                                                                      \
+        if (stack->length + count > stack->capacity) {                     \
+            stack->items = Stack_grow(stack->items, &stack->capacity,      \
+                                      stack->length + count,               \
+                                      sizeof(Type));                       \
+        }                                                                  \
+    }                                                                      \
+                                                                           \
+    static inline void Name##_push(struct Name *stack, Type item)         \
+    {                                                                      \
+        if (stack->length == stack->capacity) {                            \
+            Name##_reserve(stack, 1);                                      \
+        }                                                                  \
+        stack->items[stack->length++] = item;                              \
+    }                                                                      \
+                                                                           \
+    static inline Type Name##_pop(struct Name *stack)                     \
+    {                                                                      \
+        assert(stack->length > 0);                                         \
+        return stack->items[--stack->length];                              \
+    }                                                                      \
+                                                                           \
+    static inline void Name##_free(struct Name *stack)                    \
+    {                                                                      \
+        free(stack->items);                                                \
+        stack->items = NULL;                                               \
+        stack->length = 0;                                                 \
+        stack->capacity = 0;                                               \
+    }
+
+#endif
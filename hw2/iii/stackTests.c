@@ -15,6 +15,8 @@
 
 void printStack(Stack_T stack);
 
+STACK_DECLARE(IntStack, int)
+
 int main(int argc, char *argv[])
 {
     (void)argc;
@@ -22,34 +24,57 @@ int main(int argc, char *argv[])
 
     Stack_T test_stack;
 
-    test_stack = Stack_new();
-    void *junk;
-
-    char *a = (char*)malloc(sizeof(char));
-    *a = 'a';
-    char *b = (char*)malloc(sizeof(char));
-    *b = 'b';
-    char *c = (char*)malloc(sizeof(char));
-    *c = 'c';
-    Stack_push(test_stack, a);
-    Stack_push(test_stack, b);
-    Stack_push(test_stack, c);
-    junk = Stack_pop(test_stack);
-    free(junk);
-    junk = Stack_pop(test_stack);
-    free(junk);
-    junk = Stack_pop(test_stack);
-    free(junk);
+    test_stack = Stack_new(sizeof(char));
+    char junk;
+
+    char a = 'a';
+    char b = 'b';
+    char c = 'c';
+    Stack_push(test_stack, &a);
+    Stack_push(test_stack, &b);
+    Stack_push(test_stack, &c);
+    assert(*(char*)Stack_top(test_stack) == 'c');
+    Stack_pop(test_stack, &junk);
+    assert(junk == 'c');
+    Stack_pop(test_stack, &junk);
+    assert(junk == 'b');
+    Stack_pop(test_stack, &junk);
+    assert(junk == 'a');
+    assert(Stack_isEmpty(test_stack));
+
+    /* Growing past the first buffer, and reserving ahead */
+    Stack_reserve(test_stack, 1000);
+    for (int i = 0; i < 5000; i++) {
+        char letter = 'a' + i % 26;
+        Stack_push(test_stack, &letter);
+    }
+    assert(Stack_size(test_stack) == 5000);
+    printStack(test_stack);
     Stack_free(&test_stack);
+    assert(test_stack == NULL);
+
+    struct IntStack ints = { NULL, 0, 0 };
+    IntStack_reserve(&ints, 10);
+    for (int i = 0; i < 5000; i++) {
+        IntStack_push(&ints, i);
+    }
+    for (int i = 4999; i >= 0; i--) {
+        assert(IntStack_pop(&ints) == i);
+    }
+    IntStack_free(&ints);
+
+    printf("All stack tests passed\n");
     return EXIT_SUCCESS;
 }
 
 void printStack(Stack_T stack)
 {
     int size = Stack_size(stack);
+    char letter;
 
     while (size > 0) {
-        printf("%c \n", *(char*)Stack_pop(stack));
+        Stack_pop(stack, &letter);
+        assert(letter == 'a' + (size - 1) % 26);
         size--;
     }
-}
\ No newline at end of file
+}
@@ -3,8 +3,24 @@
  * By: Drew Maynard and Joel Brandinger, 02/09/22
  * Interfaces, Implementations, and Images (iii)
  *
- * This program takes in an image in pbm format and removes the black
- * edges.
+ * This program takes in an image in pbm format (plain P1 or raw P4) and
+ * removes the black edges. The result is written in the same format,
+ * unless -4 asks for P4.
+ *
+ * Usage: unblackedges [-t threads] [-s rows] [-m area] [-r] [-4] [filename]
+ *
+ *   -t    remove the edges with this many threads, each labeling a band
+ *         of rows (the output is the same as with one)
+ *   -s    never hold more than this many rows of the image, reading the
+ *         file twice (for images too large for memory; the output is the
+ *         same)
+ *   -m    also remove black specks (components) of fewer than this many
+ *         pixels; every component is labeled, so this is slower (and it
+ *         cannot be used with -s)
+ *   -r    hold the image as its black runs instead of a bit per pixel,
+ *         for mostly white images such as scanned pages (cannot be used
+ *         with -t, -s or -m)
+ *   -4    write raw P4, which is an eighth of the size of P1
  *
 */
 
@@ -12,29 +28,103 @@
 #include <string.h>
 #include <stdlib.h>
 #include "fixEdge.h"
+#include "edgeStrips.h"
 
 FILE *openFile(char *filename, char *program);
+void run(FILE *fp, int threads, int strip, int minArea, bool runs,
+         bool raw);
 
 int main(int argc, char **argv)
 {
-    if (argc == 1) {
+    int threads = 1;
+    int strip = 0;
+    int minArea = 0;
+    bool raw = false;
+    bool runs = false;
+    char *name = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+            if (threads < 1) {
+                fprintf(stderr, "%s: -t needs a positive number of "
+                                "threads.\n", argv[0]);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            strip = atoi(argv[++i]);
+            if (strip < 1) {
+                fprintf(stderr, "%s: -s needs a positive number of "
+                                "rows.\n", argv[0]);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            minArea = atoi(argv[++i]);
+            if (minArea < 1) {
+                fprintf(stderr, "%s: -m needs a positive area.\n",
+                        argv[0]);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "-r") == 0) {
+            runs = true;
+        } else if (strcmp(argv[i], "-4") == 0) {
+            raw = true;
+        } else if (name == NULL) {
+            name = argv[i];
+        } else {
+            fprintf(stderr, "Too many arguments.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (strip > 0 && minArea > 0) {
+        fprintf(stderr, "%s: -m cannot be used with -s.\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (runs && (threads > 1 || strip > 0 || minArea > 0)) {
+        fprintf(stderr, "%s: -r cannot be used with -t, -s or -m.\n",
+                argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    if (name == NULL) {
     char filename[1000];
     scanf("%s", filename);
     FILE *fp = openFile(filename, argv[0]);
-    fixEdge(fp);
+    run(fp, threads, strip, minArea, runs, raw);
     fclose(fp);
-    } else if (argc == 2) {
-        FILE *fp = openFile(argv[1], "rb");
-        fixEdge(fp);
-        fclose(fp);
     } else {
-        fprintf(stderr, "Too many arguments.\n");
-        exit(EXIT_FAILURE);
+        FILE *fp = openFile(name, argv[0]);
+        run(fp, threads, strip, minArea, runs, raw);
+        fclose(fp);
     }
 
     return EXIT_SUCCESS;
 }
 
+/* run
+ *
+ *    Purpose: Remove the edges of an image, whole, a strip at a time, or
+ *             as runs
+ * Parameters: The file stream, the number of threads, the rows in a strip
+ *             (0 to read the whole image), the smallest speck to keep (0
+ *             to keep them all), whether to hold runs, and whether to
+ *             write P4
+ *    Returns: None
+ *
+*/
+void run(FILE *fp, int threads, int strip, int minArea, bool runs,
+         bool raw)
+{
+    if (runs) {
+        fixEdgeRuns(fp, raw);
+    } else if (strip > 0) {
+        fixEdgeStrips(fp, strip, threads, raw);
+    } else {
+        fixEdge(fp, threads, minArea, raw);
+    }
+}
+
 /* openFile
  *
  *    Purpose: Open a file for the user and check for success
@@ -55,20 +145,3 @@ FILE *openFile(char *filename, char *program)
         return fp;
     }
 }
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
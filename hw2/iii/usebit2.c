@@ -24,6 +24,14 @@ const int DIM2 = 7;
 
 const int MARKER = 1;  /* can only be 1 or 0 */
 
+/* What check_set has seen so far */
+struct set_visit {
+        int width;
+        long next;      /* visits must come at or after this index */
+        long visits;
+        bool ok;
+};
+
 void
 check_and_print(int i, int j, Bit2_T a, int b, void *p1) 
 {
@@ -36,6 +44,42 @@ check_and_print(int i, int j, Bit2_T a, int b, void *p1)
         printf("ar[%d,%d]\n", i, j);
 }
 
+void
+check_set(int i, int j, Bit2_T a, void *p)
+{
+        struct set_visit *visit = p;
+        long at = (long)j * visit->width + i;
+
+        /* each visit is a set bit, after the one before in row major order */
+        visit->ok &= at >= visit->next && Bit2_get(a, i, j) == 1;
+        visit->next = at + 1;
+        visit->visits++;
+}
+
+/* every: 0 for all white, 1 for all black, n for every nth bit set */
+bool
+test_map_set(int width, int height, int every)
+{
+        Bit2_T bits = Bit2_new(width, height);
+        long set = 0;
+        struct set_visit visit = { width, 0, 0, true };
+
+        for (int j = 0; j < height; j++) {
+                for (int i = 0; i < width; i++) {
+                        long at = (long)j * width + i;
+                        if (every > 0 && at % every == 0) {
+                                Bit2_put(bits, i, j, 1);
+                                set++;
+                        }
+                }
+        }
+        Bit2_map_set(bits, check_set, &visit);
+        Bit2_free(&bits);
+
+        /* in order, and as many as there are set: exactly the set bits */
+        return visit.ok && visit.visits == set;
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -71,6 +115,14 @@ main(int argc, char *argv[])
 
         Bit2_free(&test_array);
 
+        printf("Trying set bits only\n");
+        for (int width = 1; width <= 130; width += 43) {
+                OK &= test_map_set(width, DIM2, 0);
+                OK &= test_map_set(width, DIM2, 1);
+                OK &= test_map_set(width, DIM2, 3);
+                OK &= test_map_set(width, DIM2, 61);
+        }
+
         printf("The array is %sOK!\n", (OK ? "" : "NOT "));
 
 }